@@ -0,0 +1,278 @@
+#include "DatasetPipeline.h"
+
+#include<filesystem>
+#include<fstream>
+#include<algorithm>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<string.h>
+
+namespace fs = std::filesystem;
+
+// Formats stb_image decodes
+static bool IsImageFile(const fs::path& path)
+{
+	static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm" };
+
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+
+	for (auto& item : extensions)
+		if (extension == item)
+			return true;
+
+	return false;
+}
+
+// * matches any run of characters, ? any single one
+static bool MatchWildcard(const char* pattern, const char* text)
+{
+	const char* star = nullptr; // last * seen, retried with one more character each time the rest fails
+	const char* resume = nullptr;
+
+	while (*text)
+	{
+		if (*pattern == '*')
+		{
+			star = pattern++;
+			resume = text;
+		}
+		else if (*pattern == '?' || *pattern == *text)
+		{
+			pattern++;
+			text++;
+		}
+		else if (star)
+		{
+			pattern = star + 1;
+			text = ++resume;
+		}
+		else
+			return false;
+	}
+
+	while (*pattern == '*')
+		pattern++;
+
+	return *pattern == '\0';
+}
+
+std::vector<std::string> ExpandPaths(const std::string& pattern)
+{
+	std::vector<std::string> paths;
+
+	if (!pattern.empty() && pattern[0] == '@')
+	{
+		std::ifstream list(pattern.substr(1));
+		if (!list)
+			throw std::exception("List Not Found!");
+
+		std::string line;
+		while (std::getline(list, line))
+		{
+			// lists written on Windows end lines with \r
+			while (!line.empty() && isspace((unsigned char)line.back()))
+				line.pop_back();
+
+			if (!line.empty())
+				paths.push_back(line);
+		}
+
+		return paths;
+	}
+
+	if (fs::is_directory(pattern))
+	{
+		for (auto& entry : fs::directory_iterator(pattern))
+			if (entry.is_regular_file() && IsImageFile(entry.path()))
+				paths.push_back(entry.path().string());
+
+		std::sort(paths.begin(), paths.end());
+		return paths;
+	}
+
+	fs::path path(pattern);
+	std::string name = path.filename().string();
+
+	if (name.find_first_of("*?") == std::string::npos)
+	{
+		paths.push_back(pattern);
+		return paths;
+	}
+
+	fs::path directory = path.parent_path().empty() ? fs::path(".") : path.parent_path();
+
+	if (fs::is_directory(directory))
+		for (auto& entry : fs::directory_iterator(directory))
+			if (entry.is_regular_file() && MatchWildcard(name.c_str(), entry.path().filename().string().c_str()))
+				paths.push_back(entry.path().string());
+
+	std::sort(paths.begin(), paths.end());
+	return paths;
+}
+
+std::vector<std::string> GenDatasets(PatchStore& store, const std::vector<std::string>& paths, int count, int coreSize, Channels channel,
+	int threadCount, std::function<void(int, int)> callback)
+{
+	if (count <= 0 || coreSize <= 0 || threadCount < 0)
+		throw std::exception("Invalid Parameters");
+
+	const int total = paths.size();
+	std::vector<std::string> errors;
+
+	if (total == 0)
+		return errors;
+
+	if (threadCount == 0)
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	threadCount = std::min(threadCount, total);
+
+	// one seed per image drawn in path order, the patches of an image don't depend on which thread samples them
+	std::vector<unsigned int> seeds(total);
+	std::mt19937 seedEngine = Network::Deterministic::Engine(Network::RandomStream::Patch);
+	for (auto& item : seeds)
+		item = seedEngine();
+
+	// sampled images waiting to be appended, image i in slot i % window
+	struct Slot
+	{
+		float* sdData = nullptr;
+		float* hdData = nullptr;
+		std::string error;
+		bool ready = false;
+	};
+
+	const int window = threadCount * 2;
+	std::vector<Slot> slots(window);
+
+	std::mutex lock;
+	std::condition_variable readySignal, spaceSignal;
+	int next = 0, appended = 0;
+	bool stop = false;
+
+	auto work = [&]()
+	{
+		while (1)
+		{
+			int index;
+
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				spaceSignal.wait(guard, [&] { return stop || next >= total || next < appended + window; });
+
+				if (stop || next >= total)
+					return;
+
+				index = next++;
+			}
+
+			Slot result;
+
+			try
+			{
+				ImageLayer layer(paths[index], channel);
+
+				if (layer.width >= coreSize * 4 && layer.height >= coreSize * 4)
+				{
+					result.sdData = Network::AlignedAlloc((size_t)count * store.sdStride);
+					result.hdData = Network::AlignedAlloc((size_t)count * store.hdStride);
+
+					std::mt19937 gen(seeds[index]);
+					SamplePatches(layer, gen, count, coreSize, result.sdData, store.sdStride, result.hdData, store.hdStride);
+				}
+				else
+					result.error = "Image Too Small!";
+
+				layer.FreeData();
+			}
+			catch (std::exception& e)
+			{
+				Network::AlignedFree(result.sdData);
+				Network::AlignedFree(result.hdData);
+				result.sdData = result.hdData = nullptr;
+				result.error = e.what();
+			}
+
+			if (!result.error.empty())
+				result.error = paths[index] + ": " + result.error;
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				result.ready = true;
+				slots[index % window] = result;
+			}
+			readySignal.notify_one();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < threadCount; i++)
+		threads.push_back(std::thread(work));
+
+	auto finish = [&]()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stop = true;
+		}
+		spaceSignal.notify_all();
+
+		for (auto& item : threads)
+			item.join();
+
+		// images sampled after a failure to append
+		for (auto& item : slots)
+		{
+			Network::AlignedFree(item.sdData);
+			Network::AlignedFree(item.hdData);
+		}
+	};
+
+	try
+	{
+		while (appended < total)
+		{
+			Slot& slot = slots[appended % window];
+			Slot result;
+
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				readySignal.wait(guard, [&] { return slot.ready; });
+
+				result = slot;
+				slot = Slot();
+			}
+
+			if (result.error.empty())
+			{
+				// pointers into the arenas stay valid until the next Add
+				int first = store.Add(count);
+				memcpy(store.Sd(first), result.sdData, sizeof(float) * count * store.sdStride);
+				memcpy(store.Hd(first), result.hdData, sizeof(float) * count * store.hdStride);
+
+				Network::AlignedFree(result.sdData);
+				Network::AlignedFree(result.hdData);
+			}
+			else
+				errors.push_back(result.error);
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				appended++;
+			}
+			spaceSignal.notify_all();
+
+			callback(appended, total); // progress callback
+		}
+	}
+	catch (...)
+	{
+		finish();
+		throw;
+	}
+
+	finish();
+
+	return errors;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<functional>
+
+#include "Image.h"
+
+/// <summary>
+/// Image paths named by a pattern, sorted so every run sees the same order:
+/// a directory (the image files in it), a glob with * and ? in the file name, @file with one path per line, or a single path
+/// </summary>
+std::vector<std::string> ExpandPaths(const std::string& pattern);
+
+/// <summary>
+/// GenDataset over many images at once: threadCount threads decode, extract the channel and sample count patches per image,
+/// the calling thread appends them to the store in path order, so the store is the same whatever thread took an image
+/// At most 2 * threadCount sampled images wait to be appended, further decoding stalls until they are,
+/// so peak memory stays at threadCount decoded images plus the waiting patches
+/// threadCount 0 for one per hardware thread, the callback reports images appended
+/// Images that fail to load are skipped, returns a message for each
+/// </summary>
+std::vector<std::string> GenDatasets(PatchStore& store, const std::vector<std::string>& paths, int count, int coreSize, Channels channel,
+	int threadCount = 0, std::function<void(int, int)> callback = [](int, int) {});
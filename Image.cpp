@@ -111,6 +111,39 @@ ImageLayer::ImageLayer(YUVImage& image, Channels channel)
 	memcpy(data, src, width * height * sizeof(float));
 }
 
+ImageLayer::ImageLayer(std::string path, Channels channel)
+{
+	int comp;
+	unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &comp, 3);
+
+	if (pixels == nullptr)
+	{
+		throw std::exception(stbi_failure_reason());
+	}
+
+	data = new float[width * height];
+
+	for (int index = 0; index < width * height; index++)
+	{
+		float r = pixels[index * 3] / 255.0f, g = pixels[index * 3 + 1] / 255.0f, b = pixels[index * 3 + 2] / 255.0f;
+		float y, u, v;
+
+		ColorConversion::RGB2YUV(r, g, b, y, u, v);
+
+		switch (channel)
+		{
+		case Channels_Y: data[index] = y; break;
+		case Channels_U: data[index] = u; break;
+		case Channels_V: data[index] = v; break;
+		case Channels_R: data[index] = r; break;
+		case Channels_G: data[index] = g; break;
+		case Channels_B: data[index] = b; break;
+		}
+	}
+
+	stbi_image_free(pixels);
+}
+
 constexpr float& ImageLayer::Get(int x, int y)
 {
 	return data[y * width + x];
@@ -122,13 +155,8 @@ void ImageLayer::FreeData()
 		delete[] data;
 }
 
-ImageDataset::ImageDataset(ImageLayer& imageLayer, int x_in, int y_in, int size)
+void ExtractPatch(ImageLayer& imageLayer, int x_in, int y_in, int size, float* sdData, float* hdData)
 {
-	hdData = new float[size * size];
-	sdData = new float[size * size];
-
-	this->size = size;
-
 	for (int x = 0; x < size; x++)
 		for (int y = 0; y < size; y++)
 		{
@@ -142,13 +170,14 @@ ImageDataset::ImageDataset(ImageLayer& imageLayer, int x_in, int y_in, int size)
 		}
 }
 
-void ImageDataset::Free()
+void SamplePatches(ImageLayer& imageLayer, std::mt19937& gen, int count, int coreSize, float* sdData, int sdStride, float* hdData, int hdStride)
 {
-	delete[] sdData;
-	delete[] hdData;
-}
+	std::uniform_int_distribution<int> distX(coreSize * 2, imageLayer.width - coreSize * 2);
+	std::uniform_int_distribution<int> distY(coreSize * 2, imageLayer.height - coreSize * 2);
 
-void ImageDataset::DebugOutput()
-{
-	ShowData(sdData, size, size);
+	for (int i = 0; i < count; i++)
+	{
+		int x = distX(gen), y = distY(gen);
+		ExtractPatch(imageLayer, x, y, coreSize, sdData + (size_t)i * sdStride, hdData + (size_t)i * hdStride);
+	}
 }
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include<vector>
 #include<random>
 
+#include "network/Deterministic.h"
+#include "PatchStore.h"
+
 // for debug
 void ShowData(float* pixels, int width, int height);
 
@@ -85,45 +88,36 @@ public:
 
 	ImageLayer(int width, int height, float* data = nullptr);
 	ImageLayer(YUVImage& image, Channels channel);
+	ImageLayer(std::string path, Channels channel); // decodes straight into one channel, no YUVImage in between
 
 	constexpr float& Get(int x, int y);
 	void FreeData();
 };
 
-struct ImageDataset
-{
-public:
-	float* hdData;
-	float* sdData;
-
-	int size; // sd resolution, square shape
-	const int scaleCoeff = 2;
-
-	ImageDataset(ImageLayer& imageLayer, int x, int y, int size);
-	void Free();
+// SD window (every other pixel) of a size x size patch at x, y and the HD window around its centre, both size x size
+void ExtractPatch(ImageLayer& imageLayer, int x, int y, int size, float* sdData, float* hdData);
 
-	void DebugOutput();
-};
+// count random patches of imageLayer, patch i written at sdData + i * sdStride and hdData + i * hdStride
+// imageLayer must be at least 4 * coreSize wide and high
+void SamplePatches(ImageLayer& imageLayer, std::mt19937& gen, int count, int coreSize, float* sdData, int sdStride, float* hdData, int hdStride);
 
-inline void GenDataset(std::vector<ImageDataset*>& datasets, std::string path, int count, int coreSize, Channels channel)
+inline void GenDataset(PatchStore& store, std::string path, int count, int coreSize, Channels channel)
 {
-	YUVImage image(path);
-	ImageLayer layer(image, channel);
+	ImageLayer layer(path, channel);
 
-	std::random_device device;
-	std::mt19937 gen(device());
+	if (layer.width < coreSize * 4 || layer.height < coreSize * 4)
+	{
+		layer.FreeData();
+		throw std::exception("Image Too Small!");
+	}
 
-	std::uniform_int_distribution<int> distX(coreSize*2, image.width - coreSize * 2);
-	std::uniform_int_distribution<int> distY(coreSize*2, image.height - coreSize * 2);
+	std::mt19937 gen = Network::Deterministic::Engine(Network::RandomStream::Patch);
 
-	datasets.reserve(datasets.size() + count);
+	// consecutive ids are consecutive rows of the arenas
+	int first = store.Add(count);
+	SamplePatches(layer, gen, count, coreSize, store.Sd(first), store.sdStride, store.Hd(first), store.hdStride);
 
-	for (int i = 0; i < count; i++)
-	{
-		datasets.push_back(new ImageDataset(layer, distX(gen), distY(gen), coreSize));
-	}
-	delete[] layer.data;
-	image.FreeData();
+	layer.FreeData();
 }
 
 extern const float shift;
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "PatchSource.h"
+#include "network/WorkerPool.h"
+
+// splitmix64 finalizer, spreads consecutive inputs over the whole range
+static unsigned long long Mix(unsigned long long x)
+{
+	x += 0x9E3779B97F4A7C15ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+PatchSource::PatchSource(int coreSize, int count)
+{
+	if (coreSize <= 0 || count < 0)
+		throw std::exception("Invalid Parameters");
+
+	this->coreSize = coreSize;
+	this->count = count;
+
+	seed = 0;
+}
+
+PatchSource::~PatchSource()
+{
+	Clear();
+}
+
+int PatchSource::Images()
+{
+	return layers.size();
+}
+
+size_t PatchSource::Pixels()
+{
+	size_t total = 0;
+	for (auto& item : layers)
+		total += (size_t)item.width * item.height;
+
+	return total;
+}
+
+void PatchSource::Add(ImageLayer& layer)
+{
+	if (layer.width < coreSize * 4 || layer.height < coreSize * 4)
+		throw std::exception("Image Too Small!");
+
+	layers.push_back(layer);
+}
+
+std::vector<std::string> PatchSource::Load(const std::vector<std::string>& paths, Channels channel, int threadCount)
+{
+	std::vector<std::string> errors;
+
+	// decoded out of order, appended in path order
+	std::vector<ImageLayer*> decoded(paths.size(), nullptr);
+	std::vector<std::string> messages(paths.size());
+
+	Network::WorkerPool pool(threadCount);
+	pool.Run(paths.size(), 1, [&](int worker, int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			try
+			{
+				decoded[i] = new ImageLayer(paths[i], channel);
+			}
+			catch (std::exception& e)
+			{
+				messages[i] = e.what();
+			}
+		}
+	});
+
+	for (int i = 0; i < paths.size(); i++)
+	{
+		if (decoded[i])
+		{
+			try
+			{
+				Add(*decoded[i]);
+			}
+			catch (std::exception& e)
+			{
+				decoded[i]->FreeData();
+				messages[i] = e.what();
+			}
+
+			delete decoded[i];
+		}
+
+		if (!messages[i].empty())
+			errors.push_back(paths[i] + ": " + messages[i]);
+	}
+
+	return errors;
+}
+
+void PatchSource::NewEpoch(std::mt19937 engine)
+{
+	seed = ((unsigned long long)engine() << 32) | engine();
+}
+
+void PatchSource::Cut(int index, float* sdData, float* hdData)
+{
+	unsigned long long pick = Mix(seed ^ Mix((unsigned long long)index));
+	unsigned long long position = Mix(pick);
+
+	auto& layer = layers[pick % layers.size()];
+
+	// same range as GenDataset
+	int x = coreSize * 2 + (int)((position & 0xFFFFFFFF) % (layer.width - coreSize * 4 + 1));
+	int y = coreSize * 2 + (int)((position >> 32) % (layer.height - coreSize * 4 + 1));
+
+	ExtractPatch(layer, x, y, coreSize, sdData, hdData);
+}
+
+void PatchSource::Clear()
+{
+	for (auto& item : layers)
+		item.FreeData();
+
+	layers.clear();
+	layers.shrink_to_fit();
+}
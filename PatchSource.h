@@ -0,0 +1,54 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include<random>
+
+#include "Image.h"
+
+// Patches cut on the fly from decoded image planes, only the planes are stored
+// An epoch is count patches, patch i sits at an (image, x, y) that only depends on the epoch seed and i,
+// so any thread can cut any patch of an epoch and every epoch sees fresh patches
+// SD and HD windows are laid out as in ExtractPatch, coreSize x coreSize each
+class PatchSource
+{
+public:
+	int coreSize;
+	int count; // patches per epoch
+
+	PatchSource(int coreSize, int count = 0);
+	~PatchSource();
+
+	PatchSource(const PatchSource&) = delete;
+	PatchSource& operator=(const PatchSource&) = delete;
+
+	int Images();
+	size_t Pixels();
+
+	/// <summary>
+	/// Keep a plane, the source takes ownership of its data. Planes smaller than 4 * coreSize are refused
+	/// </summary>
+	void Add(ImageLayer& layer);
+
+	/// <summary>
+	/// Decode one channel of every image on threadCount threads (0 for one per hardware thread), appended in path order
+	/// Images that fail to load are skipped, returns a message for each
+	/// </summary>
+	std::vector<std::string> Load(const std::vector<std::string>& paths, Channels channel, int threadCount = 0);
+
+	/// <summary>
+	/// Draw the seed of the next epoch
+	/// </summary>
+	void NewEpoch(std::mt19937 engine);
+
+	/// <summary>
+	/// Cut patch index of the current epoch into sdData and hdData
+	/// </summary>
+	void Cut(int index, float* sdData, float* hdData);
+
+	void Clear();
+
+private:
+	std::vector<ImageLayer> layers;
+	unsigned long long seed;
+};
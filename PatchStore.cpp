@@ -0,0 +1,339 @@
+#include "PatchStore.h"
+
+#include<string.h>
+#include<stdint.h>
+#include<algorithm>
+#include<fstream>
+#include<filesystem>
+#include<climits>
+
+static const char PatchCacheMagic[8] = { 'I', 'S', 'P', 'A', 'T', 'C', 'H', '\0' };
+static const uint32_t PatchCacheVersion = 1;
+
+// Blocks start on page boundaries, so mapped rows keep the alignment of the arenas
+static const uint64_t PatchCachePage = 4096;
+
+struct PatchCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t format; // PatchFormat
+	int32_t sdCount, hdCount;
+	int32_t sdStride, hdStride; // row length in the file, in elements
+	uint64_t count;
+	uint64_t sdOffset, hdOffset; // bytes from the start of the file
+	uint64_t reserved;
+};
+
+static_assert(sizeof(PatchCacheHeader) == 64, "Patch cache header must stay 64 bytes");
+
+static uint64_t PageAlign(uint64_t offset)
+{
+	return (offset + PatchCachePage - 1) / PatchCachePage * PatchCachePage;
+}
+
+PatchStore::PatchStore(int sdCount, int hdCount)
+{
+	if (sdCount <= 0 || hdCount <= 0)
+		throw std::exception("Invalid Parameters");
+
+	this->sdCount = sdCount;
+	this->hdCount = hdCount;
+
+	sdStride = Network::AlignedStride(sdCount);
+	hdStride = Network::AlignedStride(hdCount);
+
+	sd = hd = nullptr;
+	count = capacity = 0;
+	cache = nullptr;
+}
+
+PatchStore::~PatchStore()
+{
+	Clear();
+}
+
+int PatchStore::Count()
+{
+	return count;
+}
+
+bool PatchStore::Empty()
+{
+	return count == 0;
+}
+
+void PatchStore::Reserve(int count)
+{
+	if (this->count + count <= capacity)
+		return;
+
+	int newCapacity = std::max(this->count + count, capacity * 2);
+
+	float* newSd = Network::AlignedAlloc((size_t)newCapacity * sdStride);
+	float* newHd = Network::AlignedAlloc((size_t)newCapacity * hdStride);
+
+	if (this->count > 0)
+	{
+		memcpy(newSd, sd, sizeof(float) * this->count * sdStride);
+		memcpy(newHd, hd, sizeof(float) * this->count * hdStride);
+	}
+
+	Release();
+
+	sd = newSd;
+	hd = newHd;
+	capacity = newCapacity;
+
+	order.reserve(capacity);
+}
+
+int PatchStore::Add()
+{
+	return Add(1);
+}
+
+int PatchStore::Add(int count)
+{
+	if (count < 0)
+		throw std::exception("Invalid Parameters");
+
+	// doubling keeps a million Adds to a few dozen moves
+	Reserve(count);
+
+	int first = this->count;
+	for (int id = first; id < first + count; id++)
+		order.push_back(id);
+
+	this->count += count;
+	return first;
+}
+
+float* PatchStore::Sd(int id)
+{
+	return sd + (size_t)id * sdStride;
+}
+
+float* PatchStore::Hd(int id)
+{
+	return hd + (size_t)id * hdStride;
+}
+
+void PatchStore::Gather(const int* ids, int first, int count, float* sd, int sdLd, float* hd, int hdLd)
+{
+	for (int i = 0; i < count; i++)
+	{
+		int id = ids ? ids[first + i] : first + i;
+
+		memcpy(sd + (size_t)i * sdLd, Sd(id), sizeof(float) * sdCount);
+		memcpy(hd + (size_t)i * hdLd, Hd(id), sizeof(float) * hdCount);
+	}
+}
+
+void PatchStore::Shuffle(std::mt19937 engine)
+{
+	std::shuffle(order.begin(), order.end(), engine);
+}
+
+void PatchStore::Shard(int part, int parts)
+{
+	if (parts <= 0 || part < 0 || part >= parts)
+		throw std::exception("Invalid Parameters");
+
+	order.clear();
+	for (int id = part; id < count; id += parts)
+		order.push_back(id);
+}
+
+void PatchStore::Clear()
+{
+	Release();
+
+	sd = hd = nullptr;
+	count = capacity = 0;
+
+	order.clear();
+	order.shrink_to_fit();
+}
+
+void PatchStore::Release()
+{
+	if (cache)
+	{
+		delete cache;
+		cache = nullptr;
+	}
+	else
+	{
+		Network::AlignedFree(sd);
+		Network::AlignedFree(hd);
+	}
+}
+
+ProcessState PatchStore::Save(const std::string& path, PatchFormat format)
+{
+	bool bytes = format == PatchFormat::UInt8;
+	size_t element = bytes ? 1 : sizeof(float);
+
+	PatchCacheHeader header = {};
+	memcpy(header.magic, PatchCacheMagic, sizeof(header.magic));
+	header.version = PatchCacheVersion;
+	header.format = (uint32_t)format;
+	header.sdCount = sdCount;
+	header.hdCount = hdCount;
+	header.sdStride = bytes ? sdCount : sdStride;
+	header.hdStride = bytes ? hdCount : hdStride;
+	header.count = count;
+	header.sdOffset = PageAlign(sizeof(header));
+	header.hdOffset = PageAlign(header.sdOffset + header.count * header.sdStride * element);
+
+	// written aside and renamed, a process opening the cache meanwhile never sees half a file
+	std::string temp = path + ".tmp";
+	std::ofstream stream(temp, std::ios::binary | std::ios::trunc);
+
+	if (!stream.is_open())
+		return ProcessState(false, "Cannot write " + temp);
+
+	auto writeBlock = [&](float* arena, int rowCount, int stride, uint64_t offset)
+	{
+		stream.seekp(offset);
+
+		if (!bytes)
+		{
+			stream.write((const char*)arena, sizeof(float) * count * stride);
+			return;
+		}
+
+		std::vector<unsigned char> row(rowCount);
+		for (int id = 0; id < count; id++)
+		{
+			float* values = arena + (size_t)id * stride;
+
+			for (int i = 0; i < rowCount; i++)
+				row[i] = (unsigned char)(std::clamp(values[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+
+			stream.write((const char*)row.data(), rowCount);
+		}
+	};
+
+	stream.write((const char*)&header, sizeof(header));
+	writeBlock(sd, sdCount, sdStride, header.sdOffset);
+	writeBlock(hd, hdCount, hdStride, header.hdOffset);
+
+	stream.close();
+
+	if (stream.fail())
+	{
+		std::filesystem::remove(temp);
+		return ProcessState(false, "Failed to write " + temp);
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp, path, error);
+
+	if (error)
+		return ProcessState(false, "Failed to rename patch cache: " + error.message());
+
+	return ProcessState(true);
+}
+
+ProcessState PatchStore::Open(const std::string& path)
+{
+	MappedFile* file = new MappedFile();
+
+	if (!file->Open(path))
+	{
+		delete file;
+		return ProcessState(false, "Cannot open " + path);
+	}
+
+	auto fail = [&](std::string msg)
+	{
+		delete file;
+		return ProcessState(false, msg);
+	};
+
+	if (file->Size() < sizeof(PatchCacheHeader))
+		return fail("Not a patch cache");
+
+	PatchCacheHeader header;
+	memcpy(&header, file->Data(), sizeof(header));
+
+	if (memcmp(header.magic, PatchCacheMagic, sizeof(header.magic)) != 0)
+		return fail("Not a patch cache");
+
+	if (header.version != PatchCacheVersion)
+		return fail("Unsupported patch cache version " + std::to_string(header.version));
+
+	if (header.format != (uint32_t)PatchFormat::Float && header.format != (uint32_t)PatchFormat::UInt8)
+		return fail("Unknown patch cache format");
+
+	if (header.sdCount != sdCount || header.hdCount != hdCount)
+		return fail("Patch size mismatch");
+
+	if (header.sdStride < sdCount || header.hdStride < hdCount || header.count > INT_MAX)
+		return fail("Corrupted patch cache");
+
+	bool bytes = header.format == (uint32_t)PatchFormat::UInt8;
+	uint64_t element = bytes ? 1 : sizeof(float);
+
+	// a block of count rows at offset lies within the file, offsets are checked first so nothing wraps around
+	// count <= INT_MAX and stride <= INT_MAX, so the block size itself fits in 64 bits
+	uint64_t size = file->Size();
+	auto fits = [&](uint64_t offset, int32_t stride)
+	{
+		return offset <= size && header.count * (uint64_t)stride * element <= size - offset;
+	};
+
+	if (header.sdOffset % PatchCachePage != 0 || header.hdOffset % PatchCachePage != 0 || (header.count > 0 &&
+		(!fits(header.sdOffset, header.sdStride) || !fits(header.hdOffset, header.hdStride))))
+		return fail("Corrupted patch cache");
+
+	Clear();
+
+	int patchCount = (int)header.count;
+	unsigned char* data = file->Data();
+
+	if (!bytes && header.sdStride == sdStride && header.hdStride == hdStride)
+	{
+		// the file is the arenas
+		sd = (float*)(data + header.sdOffset);
+		hd = (float*)(data + header.hdOffset);
+		cache = file;
+	}
+	else
+	{
+		sd = Network::AlignedAlloc((size_t)patchCount * sdStride);
+		hd = Network::AlignedAlloc((size_t)patchCount * hdStride);
+
+		auto readBlock = [&](float* arena, int rowCount, int stride, uint64_t offset, int fileStride)
+		{
+			for (int id = 0; id < patchCount; id++)
+			{
+				float* row = arena + (size_t)id * stride;
+
+				if (bytes)
+				{
+					const unsigned char* values = data + offset + (uint64_t)id * fileStride;
+					for (int i = 0; i < rowCount; i++)
+						row[i] = values[i] * (1.0f / 255.0f);
+				}
+				else
+					memcpy(row, data + offset + (uint64_t)id * fileStride * sizeof(float), sizeof(float) * rowCount);
+			}
+		};
+
+		readBlock(sd, sdCount, sdStride, header.sdOffset, header.sdStride);
+		readBlock(hd, hdCount, hdStride, header.hdOffset, header.hdStride);
+
+		delete file;
+	}
+
+	count = capacity = patchCount;
+
+	order.resize(count);
+	for (int id = 0; id < count; id++)
+		order[id] = id;
+
+	return ProcessState(true);
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include<vector>
+#include<random>
+#include<string>
+
+#include "network/NetworkStructure.h"
+#include "network/FileHelper.h"
+#include "network/ProcessState.h"
+
+// Element type of the blocks of a patch cache file
+enum class PatchFormat
+{
+	Float, // arena rows as they are, opened in place
+	UInt8 // values of [0, 1] in 1/255 steps, a quarter of the size, expanded to floats when opened
+};
+
+// Training patches in two contiguous arenas, SD inputs and HD targets, indexed by patch id
+// Each arena is a row-major matrix with one row per patch, rows padded to whole cache lines,
+// so a run of patches is a strided matrix that can be gathered or read in place
+// Training visits patches through order, shuffling permutes ids and never moves patch data
+// Patch cache file, little-endian: a 64-byte header, then the SD block and the HD block, each page aligned,
+// one row per patch id. A Float cache is mapped as the arenas themselves, so opening it costs no reads
+// and processes opening the same cache share its pages
+class PatchStore
+{
+public:
+	int sdCount, hdCount; // floats per patch
+	int sdStride, hdStride; // leading dimension of each arena
+
+	std::vector<int> order; // ids in training order, every patch after Add
+
+	PatchStore(int sdCount, int hdCount);
+	~PatchStore();
+
+	PatchStore(const PatchStore&) = delete;
+	PatchStore& operator=(const PatchStore&) = delete;
+
+	// patches stored, not the length of order
+	int Count();
+	bool Empty();
+
+	/// <summary>
+	/// Make room for count more patches, so a known number of Add calls never moves the arenas
+	/// </summary>
+	void Reserve(int count);
+
+	/// <summary>
+	/// Append a zeroed patch, returns its id. Pointers from Sd and Hd are invalidated if the arenas grow
+	/// </summary>
+	int Add();
+
+	/// <summary>
+	/// Append count zeroed patches with consecutive ids, returns the first one
+	/// </summary>
+	int Add(int count);
+
+	float* Sd(int id);
+	float* Hd(int id);
+
+	/// <summary>
+	/// Copy patches ids[first, first + count), or ids [first, first + count) when ids is nullptr, into two row-major matrices
+	/// </summary>
+	void Gather(const int* ids, int first, int count, float* sd, int sdLd, float* hd, int hdLd);
+
+	void Shuffle(std::mt19937 engine);
+
+	/// <summary>
+	/// Order every parts-th patch starting at id part, ascending, Shard(0, 1) orders the whole store
+	/// </summary>
+	void Shard(int part, int parts);
+
+	/// <summary>
+	/// Release every patch at once
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Write every patch to a cache file, in id order
+	/// </summary>
+	ProcessState Save(const std::string& path, PatchFormat format);
+
+	/// <summary>
+	/// Replace the patches with those of a cache file written for the same patch sizes
+	/// A Float cache is mapped copy-on-write until the first Add moves it into memory of its own
+	/// </summary>
+	ProcessState Open(const std::string& path);
+
+private:
+	float* sd;
+	float* hd;
+	int count, capacity;
+
+	MappedFile* cache; // the arenas live in this mapping, nullptr when they are allocated
+
+	void Release();
+};
@@ -6,11 +6,22 @@
 
 #include "network/Network.h"
 #include "Image.h"
+#include "DatasetPipeline.h"
+#include "PatchSource.h"
 #include "network/ProgressTimer.h"
+#include "network/VectorAccelator.h"
 
 Network::Connectivity::FullConnNetwork* networkPtr = nullptr;
-std::vector<ImageDataset*> datasets;
+Network::Connectivity::QuantizedNetwork* quantizedPtr = nullptr; // int8 copy of networkPtr used by Scale(), if any
+Network::Connectivity::HalfNetwork* halfPtr = nullptr; // 16-bit copy of networkPtr used by Scale(), if any
+Network::Connectivity::NetworkEvaluator* evaluatorPtr = nullptr; // bound to the layers of networkPtr
+
+// checkpoints taken by Train() and TrainAsync(), set by the checkpoint command, off while checkpointPrefix is empty
+std::string checkpointPrefix;
+int checkpointKeep = 3, checkpointBatches = 0, checkpointMinutes = 0;
 const int coreSize = 8;
+PatchStore patches(coreSize * coreSize, coreSize * coreSize);
+PatchSource source(coreSize); // lazy mode while it holds planes, training cuts source.count fresh patches per epoch instead of using patches
 
 void PrintValues(float* value, int count)
 {
@@ -34,6 +45,116 @@ void DisplayProgress(float progress)
 	std::cerr << out;
 }
 
+// The quantized and half copies go stale whenever the float network changes
+void DropInferenceNetworks()
+{
+	if (quantizedPtr)
+	{
+		quantizedPtr->Destroy();
+		delete quantizedPtr;
+		quantizedPtr = nullptr;
+
+		std::cout << "Quantized network dropped." << std::endl;
+	}
+
+	if (halfPtr)
+	{
+		halfPtr->Destroy();
+		delete halfPtr;
+		halfPtr = nullptr;
+
+		std::cout << "Half network dropped." << std::endl;
+	}
+}
+
+// The evaluator's batches point into the layers of the network it was built for
+void DropEvaluator()
+{
+	delete evaluatorPtr;
+	evaluatorPtr = nullptr;
+}
+
+bool ParseHalfFormat(const std::string& name, HalfFormat& format)
+{
+	if (name == "fp16")
+		format = HalfFormat::FP16;
+	else if (name == "bf16")
+		format = HalfFormat::BF16;
+	else
+		return false;
+
+	return true;
+}
+
+bool ParseOptimizerType(const std::string& name, Network::OptimizerType& type)
+{
+	if (name == "sgd")
+		type = Network::OptimizerType::SGD;
+	else if (name == "momentum")
+		type = Network::OptimizerType::Momentum;
+	else if (name == "nesterov")
+		type = Network::OptimizerType::Nesterov;
+	else if (name == "adam")
+		type = Network::OptimizerType::Adam;
+	else
+		return false;
+
+	return true;
+}
+
+// Loss of the network over every sample, or estimated from sampleCount random samples, the evaluator is kept across epochs
+Network::Connectivity::EvaluationResult Evaluate(int sampleCount = 0)
+{
+	if (!evaluatorPtr)
+		evaluatorPtr = new Network::Connectivity::NetworkEvaluator(networkPtr);
+
+	if (sampleCount > 0)
+		return evaluatorPtr->Estimate(patches, sampleCount);
+
+	return evaluatorPtr->Evaluate(patches);
+}
+
+// Checkpoint writer for a training run, nullptr when checkpoints are off
+Network::CheckpointWriter* StartCheckpoints()
+{
+	if (checkpointPrefix.empty())
+		return nullptr;
+
+	return new Network::CheckpointWriter(networkPtr, checkpointPrefix, checkpointKeep, checkpointBatches, checkpointMinutes * 60);
+}
+
+// Waits for the write in flight
+void StopCheckpoints(Network::CheckpointWriter* checkpoint)
+{
+	if (!checkpoint)
+		return;
+
+	checkpoint->Wait();
+
+	ProcessState state = checkpoint->LastState();
+	std::cout << std::format("Checkpoints written: {}", checkpoint->Written()) << std::endl;
+	if (!state.success)
+		std::cout << "Last checkpoint failed. Message: " << state.msg << std::endl;
+
+	delete checkpoint;
+}
+
+// Epoch report: the running loss comes for free from training, a subsample estimate is only taken when asked for
+// Returns the estimate if there is one, the running loss otherwise
+double ReportLoss(double trainLoss, int lossSamples, long long trainTime)
+{
+	std::cout << std::endl << std::format("Train Loss: {}, Training Time: {}ms", trainLoss, trainTime / 1000000) << std::endl;
+
+	// lazy mode leaves no stored patches, each epoch trains on patches never seen before anyway
+	if (lossSamples <= 0 || patches.Empty())
+		return trainLoss;
+
+	auto result = Evaluate(lossSamples);
+	std::cout << std::format("Est. Loss: {} +/- {}, PSNR: {:.2f}dB, {} samples", result.loss, result.confidence, result.psnr, result.sampleCount) << std::endl;
+
+	return result.loss;
+}
+
 void Train()
 {
 	if (!networkPtr)
@@ -43,7 +164,7 @@ void Train()
 	}
 
 	float learningRate;
-	int repeat, batchSize;
+	int repeat, batchSize, lossSamples;
 
 	std::cout << "Learning Rate> ";
 	std::cin >> learningRate;
@@ -51,106 +172,525 @@ void Train()
 	std::cin >> repeat;
 	std::cout << "Batch Size> ";
 	std::cin >> batchSize;
+	std::cout << "Loss Samples(0 for training loss only)> ";
+	std::cin >> lossSamples;
+
+	if (repeat <= 0 || batchSize <= 0)
+	{
+		std::cout << "Invalid settings!" << std::endl;
+		return;
+	}
 
 	std::cout << "Working..." << std::endl;
 
+	DropInferenceNetworks();
+
 	auto& network = *networkPtr;
 
 	network.learningRate = learningRate;
 
+	long long trainTime = 0; // ns, loss evaluation excluded
+	long long loaderStall = 0; // ns of trainTime spent waiting for minibatches to be assembled
+
+	Network::CheckpointWriter* checkpoint = StartCheckpoints();
+
 	for (int iter = 0; iter < repeat; iter++)
 	{
 		std::cout << "Iteration " << iter + 1 << ", Shuffling Data..." << std::endl;
 
-		std::shuffle(datasets.begin(), datasets.end(), std::mt19937(std::random_device()()));
+		if (source.Images() > 0)
+			source.NewEpoch(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+		else
+			patches.Shuffle(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+
+		ProgressTimer timer;
+		double trainLoss = 0.0;
+
+		const int interval = std::max(15, 500 / batchSize); // batches between progress updates
 
-		if (batchSize == 1)
+		auto progress = [batchSize, interval, checkpoint](int done, int total)
 		{
-			for (int i = 0; i < datasets.size(); i++)
-			{
-				auto& data = datasets[i];
+			if (checkpoint)
+				checkpoint->Tick();
 
-				network.PushDataFloat(data->sdData);
-				network.PushTargetFloat(data->hdData);
-				network.ForwardTransmit();
-				network.BackwardTransmit();
-				network.UpdateWeights();
+			if (done / batchSize % interval == 0)
+				DisplayProgress((float)done / total);
+		};
 
-				if(i % 500 == 0)
-					DisplayProgress((float)i / datasets.size());
-			}
+		// a batch of one is the per-sample step
+		if (source.Images() > 0)
+			trainLoss = network.TrainBatched(source, batchSize, learningRate, progress);
+		else
+			trainLoss = network.TrainBatched(patches, batchSize, learningRate, progress);
+
+		trainTime += timer.Count();
+		loaderStall += network.loaderStall;
+
+		ReportLoss(trainLoss, lossSamples, trainTime);
+		std::cout << std::format("Loader Stall: {}ms", loaderStall / 1000000) << std::endl;
+	}
+
+	StopCheckpoints(checkpoint);
+
+	std::cout << "Done." << std::endl;
+}
+
+// Hogwild workers can't share optimizer state or 16-bit weight copies, lockstep mode can
+bool CheckAsyncSettings()
+{
+	if (Network::Deterministic::Enabled())
+		return true;
+
+	if (networkPtr->optimizer.type != Network::OptimizerType::SGD)
+	{
+		std::cout << "Asynchronous training takes plain SGD steps, select sgd or set a seed for lockstep mode!" << std::endl;
+		return false;
+	}
+
+	if (networkPtr->mixedPrecision)
+	{
+		std::cout << "Asynchronous training runs in full precision, select fp32 or set a seed for lockstep mode!" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Asynchronous training, stops early once the loss reaches a target so it can be timed against Train()
+void TrainAsync()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	if (!CheckAsyncSettings())
+		return;
+
+	float learningRate, targetLoss;
+	int repeat, localBatch, syncInterval, lossSamples;
+
+	std::cout << "Learning Rate> ";
+	std::cin >> learningRate;
+	std::cout << "Repeat> ";
+	std::cin >> repeat;
+	std::cout << "Local Batch> ";
+	std::cin >> localBatch;
+	std::cout << "Sync Interval> ";
+	std::cin >> syncInterval;
+	std::cout << "Target Loss> ";
+	std::cin >> targetLoss;
+	std::cout << "Loss Samples(0 for training loss only)> ";
+	std::cin >> lossSamples;
+
+	if (repeat <= 0 || localBatch <= 0 || syncInterval <= 0)
+	{
+		std::cout << "Invalid settings!" << std::endl;
+		return;
+	}
+
+	std::cout << "Working..." << std::endl;
+
+	DropInferenceNetworks();
+
+	auto& network = *networkPtr;
+
+	long long trainTime = 0; // ns, loss evaluation excluded
+
+	Network::CheckpointWriter* checkpoint = StartCheckpoints();
+
+	for (int iter = 0; iter < repeat; iter++)
+	{
+		std::cout << "Iteration " << iter + 1 << ", Shuffling Data..." << std::endl;
+
+		ProgressTimer timer;
+
+		auto progress = [checkpoint](int done, int total)
+		{
+			if (checkpoint)
+				checkpoint->Tick();
+
+			DisplayProgress((float)done / total);
+		};
+
+		double trainLoss;
+
+		if (source.Images() > 0)
+		{
+			source.NewEpoch(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+			trainLoss = network.TrainAsync(source, localBatch, syncInterval, learningRate, progress);
 		}
 		else
 		{
-			Network::Connectivity::FullConnNetworkInstance instance(networkPtr);
+			patches.Shuffle(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+			trainLoss = network.TrainAsync(patches, localBatch, syncInterval, learningRate, progress);
+		}
 
-			for (int i = 0; i < datasets.size(); i++)
-			{
-				auto& data = datasets[i];
+		trainTime += timer.Count();
 
-				instance.FetchBias();
-				instance.PushData(data->sdData);
-				instance.PushTarget(data->hdData);
+		double loss = ReportLoss(trainLoss, lossSamples, trainTime);
 
-				instance.ForwardTransmit();
-				instance.BackwardTransmit();
+		if (loss <= targetLoss)
+		{
+			std::cout << std::format("Target loss reached after {} iterations, {}ms", iter + 1, trainTime / 1000000) << std::endl;
+			break;
+		}
+	}
 
-				instance.FeedBack();
+	StopCheckpoints(checkpoint);
 
-				if (i % batchSize == 0)
-				{
-					network.computeAverage(batchSize);
-					network.UpdateWeights();
-					network.ClearSum();
+	std::cout << "Done." << std::endl;
+}
 
-					if (i / batchSize % 15 == 0)
-						DisplayProgress((float)i / datasets.size());
-				}
-			}
+// Weights and biases of src into dst, a network of the same shape
+void CopyWeights(Network::Connectivity::FullConnNetwork& dst, Network::Connectivity::FullConnNetwork& src)
+{
+	auto copy = [&](Network::NeuronLayer& to, Network::NeuronLayer& from)
+	{
+		memcpy(to.weights, from.weights, sizeof(Network::float_n) * from.neuronCount * from.stride);
+		to.bias = from.bias;
+
+		dst.RefreshHalfWeights(to);
+	};
+
+	copy(dst.outLayer, src.outLayer);
+	for (int i = 0; i < src.hiddenLayerCount; i++)
+		copy(dst.hiddenLayerList[i], src.hiddenLayerList[i]);
+}
+
+// Time to a target running loss of Train() against TrainAsync(), both starting from the current weights
+// The weights are left as they were, optimizer state is reset
+void BenchAsync()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	if (patches.Empty() && source.Images() == 0)
+	{
+		std::cout << "No dataset loaded!" << std::endl;
+		return;
+	}
+
+	if (!CheckAsyncSettings())
+		return;
+
+	float learningRate, targetLoss;
+	int maxRepeat, batchSize, localBatch, syncInterval;
+
+	std::cout << "Learning Rate> ";
+	std::cin >> learningRate;
+	std::cout << "Max Repeat> ";
+	std::cin >> maxRepeat;
+	std::cout << "Batch Size> ";
+	std::cin >> batchSize;
+	std::cout << "Local Batch> ";
+	std::cin >> localBatch;
+	std::cout << "Sync Interval> ";
+	std::cin >> syncInterval;
+	std::cout << "Target Loss> ";
+	std::cin >> targetLoss;
+
+	if (maxRepeat <= 0 || batchSize <= 0 || localBatch <= 0 || syncInterval <= 0)
+	{
+		std::cout << "Invalid settings!" << std::endl;
+		return;
+	}
+
+	std::cout << "Working..." << std::endl;
+
+	DropInferenceNetworks();
+
+	auto& network = *networkPtr;
+
+	auto start = new Network::Connectivity::FullConnNetwork(network.inNeuronCount, network.outNeuronCount, network.hiddenNeuronCount, network.hiddenLayerCount,
+		network.ActivateFunc, 0.0, network.outLayerSoftMax);
+	CopyWeights(*start, network);
 
-			instance.FreeData();
+	// ns until the running loss reached the target, -1 if it never did
+	auto run = [&](const std::string& name, std::function<double()> epoch)
+	{
+		CopyWeights(network, *start);
+		network.SetOptimizer(network.optimizer); // fresh optimizer state for every run
+
+		long long time = 0;
+
+		for (int iter = 0; iter < maxRepeat; iter++)
+		{
+			if (source.Images() > 0)
+				source.NewEpoch(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+			else
+				patches.Shuffle(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+
+			ProgressTimer timer;
+			double loss = epoch();
+			time += timer.Count();
+
+			std::cout << std::format("{} iteration {}: Train Loss: {}, {}ms", name, iter + 1, loss, time / 1000000) << std::endl;
+
+			if (loss <= targetLoss)
+				return time;
 		}
 
-		std::atomic<double> totalLoss = 0.0;
+		std::cout << std::format("{} missed the target loss in {} iterations", name, maxRepeat) << std::endl;
+		return -1LL;
+	};
 
-		std::cout << std::endl << "Calculating avg loss..." << std::endl;
+	long long syncTime = run("Train", [&]
+	{
+		if (source.Images() > 0)
+			return network.TrainBatched(source, batchSize, learningRate);
 
-		std::vector<Network::Connectivity::FullConnNetworkInstance*> instances;
-		for (int i = 0; i < omp_get_max_threads(); i++)
-			instances.push_back(new Network::Connectivity::FullConnNetworkInstance(networkPtr));
+		return network.TrainBatched(patches, batchSize, learningRate);
+	});
 
-#pragma omp parallel for
-		for (int i = 0; i < datasets.size(); i++)
+	long long asyncTime = run("TrainAsync", [&]
+	{
+		if (source.Images() > 0)
+			return network.TrainAsync(source, localBatch, syncInterval, learningRate);
+
+		return network.TrainAsync(patches, localBatch, syncInterval, learningRate);
+	});
+
+	if (syncTime >= 0 && asyncTime >= 0)
+		std::cout << std::format("Time to loss {}: Train {}ms, TrainAsync {}ms, speedup {:.2f}x", targetLoss, syncTime / 1000000, asyncTime / 1000000,
+			(double)syncTime / std::max(asyncTime, 1LL)) << std::endl;
+
+	CopyWeights(network, *start);
+	network.SetOptimizer(network.optimizer);
+
+	start->Destroy();
+	delete start;
+
+	std::cout << "Done." << std::endl;
+}
+
+// Data-parallel training, one process per rank, every rank loads the same datasets and trains on every worldSize-th patch
+void TrainDistributed()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	float learningRate;
+	int rank, worldSize, basePort, repeat, batchSize;
+	std::string nextHost;
+
+	std::cout << "Rank> ";
+	std::cin >> rank;
+	std::cout << "World Size> ";
+	std::cin >> worldSize;
+	std::cout << "Next Host(127.0.0.1 on one machine)> ";
+	std::cin >> nextHost;
+	std::cout << "Base Port> ";
+	std::cin >> basePort;
+	std::cout << "Learning Rate> ";
+	std::cin >> learningRate;
+	std::cout << "Repeat> ";
+	std::cin >> repeat;
+	std::cout << "Batch Size> ";
+	std::cin >> batchSize;
+
+	if (worldSize <= 0 || rank < 0 || rank >= worldSize)
+	{
+		std::cout << "Invalid rank!" << std::endl;
+		return;
+	}
+
+	if (repeat <= 0 || batchSize <= 0)
+	{
+		std::cout << "Invalid settings!" << std::endl;
+		return;
+	}
+
+	std::cout << "Joining the ring..." << std::endl;
+
+	DropInferenceNetworks();
+
+	auto& network = *networkPtr;
+
+	patches.Shard(rank, worldSize);
+
+	// every rank holds the same weights, one copy on disk is enough
+	Network::CheckpointWriter* checkpoint = nullptr;
+
+	try
+	{
+		Network::RingAllReduce ring(rank, worldSize, nextHost, basePort);
+
+		long long trainTime = 0; // ns
+
+		if (rank == 0)
+			checkpoint = StartCheckpoints();
+
+		for (int iter = 0; iter < repeat; iter++)
 		{
-			/*auto& data = datasets[i];
+			std::cout << "Iteration " << iter + 1 << ", Shuffling Data..." << std::endl;
+
+			patches.Shuffle(Network::Deterministic::Engine(Network::RandomStream::Shuffle));
+
+			ProgressTimer timer;
+
+			double trainLoss = network.TrainDistributed(patches, batchSize, learningRate, ring, [batchSize, checkpoint](int done, int total)
+			{
+				if (checkpoint)
+					checkpoint->Tick();
+
+				if (done / batchSize % 15 == 0)
+					DisplayProgress((float)done / total);
+			});
+
+			trainTime += timer.Count();
+
+			ReportLoss(trainLoss, 0, trainTime);
+		}
+	}
+	catch (std::exception e)
+	{
+		std::cout << "Distributed training failed. Message: " << e.what() << std::endl;
+	}
+
+	StopCheckpoints(checkpoint);
+
+	patches.Shard(0, 1);
+
+	std::cout << "Done." << std::endl;
+}
+
+void SelectOptimizer()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	std::string name;
+	Network::OptimizerSettings settings;
+	std::cout << "Optimizer(sgd/momentum/nesterov/adam)> ";
+	std::cin >> name;
+
+	if (!ParseOptimizerType(name, settings.type))
+	{
+		std::cout << "Unknown optimizer!" << std::endl;
+		return;
+	}
+
+	if (settings.type == Network::OptimizerType::Momentum || settings.type == Network::OptimizerType::Nesterov)
+	{
+		std::cout << "Momentum> ";
+		std::cin >> settings.momentum;
+	}
+	else if (settings.type == Network::OptimizerType::Adam)
+	{
+		std::cout << "Beta1> ";
+		std::cin >> settings.beta1;
+		std::cout << "Beta2> ";
+		std::cin >> settings.beta2;
+	}
 
-			network.PushDataFloat(data->sdData);
-			network.PushTargetFloat(data->hdData);
+	networkPtr->SetOptimizer(settings);
 
-			network.ForwardTransmit();
-			totalLoss += network.GetLoss();*/
+	std::cout << "Done." << std::endl;
+}
+
+void SelectPrecision()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	std::string name;
+	HalfFormat format;
+	std::cout << "Training Precision(fp32/fp16/bf16)> ";
+	std::cin >> name;
+
+	if (name == "fp32")
+	{
+		networkPtr->SetMixedPrecision(false);
+	}
+	else if (ParseHalfFormat(name, format))
+	{
+		networkPtr->SetMixedPrecision(true, format);
+
+		if (format == HalfFormat::BF16 && !VectorAccelator::HasBF16())
+			std::cout << "No AVX512-BF16, BF16 weights will be widened to float for the products." << std::endl;
+	}
+	else
+	{
+		std::cout << "Unknown precision!" << std::endl;
+		return;
+	}
+
+	std::cout << "Done." << std::endl;
+}
+
+void Checkpoint()
+{
+	std::cout << "Path Prefix(\"off\" to disable)> ";
+	std::cin >> checkpointPrefix;
+
+	if (checkpointPrefix == "off")
+	{
+		checkpointPrefix.clear();
+		std::cout << "Done." << std::endl;
+		return;
+	}
+
+	std::cout << "Keep Count> ";
+	std::cin >> checkpointKeep;
+	std::cout << "Every Batches(0 for off)> ";
+	std::cin >> checkpointBatches;
+	std::cout << "Every Minutes(0 for off)> ";
+	std::cin >> checkpointMinutes;
+
+	if (checkpointKeep <= 0 || checkpointBatches < 0 || checkpointMinutes < 0)
+	{
+		std::cout << "Invalid settings, checkpoints disabled." << std::endl;
+		checkpointPrefix.clear();
+		return;
+	}
 
-			auto& instance = *instances[omp_get_thread_num()];
-			instance.FetchBias();
+	std::cout << "Done." << std::endl;
+}
 
-			auto& data = datasets[i];
+void Seed()
+{
+	std::string value;
+	std::cout << "Seed(\"off\" for nondeterministic runs)> ";
+	std::cin >> value;
 
-			instance.PushData(data->sdData);
-			instance.PushTarget(data->hdData);
-			instance.ForwardTransmit();
+	if (value == "off")
+	{
+		Network::Deterministic::Disable();
+	}
+	else
+	{
+		unsigned long seed;
 
-			totalLoss += instance.GetLoss();
+		try
+		{
+			seed = std::stoul(value);
 		}
-
-		for (auto& item : instances)
+		catch (std::exception&)
 		{
-			item->FreeData();
-			delete item;
+			std::cout << "Invalid seed!" << std::endl;
+			return;
 		}
 
-		std::cout << "Avg Loss: " << totalLoss / datasets.size() << std::endl;
+		Network::Deterministic::Enable((unsigned int)seed);
+		std::cout << "Networks and datasets created from now on are reproducible too." << std::endl;
 	}
 
+	DropEvaluator(); // its subsample stream follows the mode
+
 	std::cout << "Done." << std::endl;
 }
 
@@ -164,6 +704,9 @@ void NewNetwork()
 
 	std::cout << "Working..." << std::endl;
 
+	DropInferenceNetworks();
+	DropEvaluator();
+
 	if (networkPtr)
 	{
 		networkPtr->Destroy();
@@ -214,76 +757,85 @@ void Scale()
 
 	std::atomic<int> progress = 0;
 
-	std::vector<Network::Connectivity::FullConnNetworkInstance*> tempNetworks;
+	// every column of tiles is transmitted as one batch, Y, U and V tiles stacked together
+	const int tileCount = newHeight / coreSize;
+
+	std::vector<Network::Connectivity::FullConnNetworkBatch*> tempNetworks;
+	std::vector<Network::Connectivity::QuantizedNetworkBatch*> quantizedNetworks;
+	std::vector<Network::Connectivity::HalfNetworkBatch*> halfNetworks;
 
 	int threadCount = omp_get_max_threads();
 	for (int i = 0; i < threadCount; i++)
 	{
-		tempNetworks.push_back(new Network::Connectivity::FullConnNetworkInstance(networkPtr));
+		if (quantizedPtr)
+			quantizedNetworks.push_back(new Network::Connectivity::QuantizedNetworkBatch(quantizedPtr, tileCount * 3));
+		else if (halfPtr)
+			halfNetworks.push_back(new Network::Connectivity::HalfNetworkBatch(halfPtr, tileCount * 3));
+		else
+			tempNetworks.push_back(new Network::Connectivity::FullConnNetworkBatch(networkPtr, tileCount * 3));
 	}
 
-#pragma omp parallel for
-	for (int x = 0; x < newWidth; x += coreSize)
+	if (quantizedPtr)
+		std::cout << "Using quantized network." << std::endl;
+	else if (halfPtr)
+		std::cout << "Using half network." << std::endl;
+
+	// same for float, quantized and half batches
+	auto scaleColumn = [&](auto& nwk, int x)
 	{
 		using namespace Network;
 
-		int threadnum = omp_get_thread_num();
-
-		auto& nwk = *tempNetworks[threadnum];
-
-		for (int y = 0; y < output_y.height; y += coreSize)
+		// feed in data
+		for (int tile = 0; tile < tileCount; tile++)
 		{
-			// feed in data, Y
-			for (int _x = 0; _x < coreSize; _x++)
-				for (int _y = 0; _y < coreSize; _y++)
-				{
-					nwk.inLayer.value[_y * coreSize + _x] = yLayer.Get(x / 2 + _x, y / 2 + _y);
-				}
+			int y = tile * coreSize;
 
-			nwk.ForwardTransmit();
+			float_n* inY = nwk.GetInput(tile);
+			float_n* inU = nwk.GetInput(tileCount + tile);
+			float_n* inV = nwk.GetInput(tileCount * 2 + tile);
 
-			for (int _x = 0; _x < coreSize; _x++)
-			{
-				for (int _y = 0; _y < coreSize; _y++)
-				{
-					output_y.Get(x + _x, y + _y) = nwk.outLayer.value[_y * coreSize + _x];
-				}
-			}
-
-			// U
 			for (int _x = 0; _x < coreSize; _x++)
 				for (int _y = 0; _y < coreSize; _y++)
 				{
-					nwk.inLayer.value[_y * coreSize + _x] = uLayer.Get(x / 2 + _x, y / 2 + _y) + 0.5;
+					inY[_y * coreSize + _x] = yLayer.Get(x / 2 + _x, y / 2 + _y);
+					inU[_y * coreSize + _x] = uLayer.Get(x / 2 + _x, y / 2 + _y) + 0.5;
+					inV[_y * coreSize + _x] = vLayer.Get(x / 2 + _x, y / 2 + _y) + 0.5;
 				}
+		}
 
-			nwk.ForwardTransmit();
-
-			for (int _x = 0; _x < coreSize; _x++)
-			{
-				for (int _y = 0; _y < coreSize; _y++)
-				{
-					output_u.Get(x + _x, y + _y) = nwk.outLayer.value[_y * coreSize + _x] - 0.5;
-				}
-			}
+		nwk.ForwardTransmit(tileCount * 3);
 
-			// V
-			for (int _x = 0; _x < coreSize; _x++)
-				for (int _y = 0; _y < coreSize; _y++)
-				{
-					nwk.inLayer.value[_y * coreSize + _x] = vLayer.Get(x / 2 + _x, y / 2 + _y) + 0.5;
-				}
+		for (int tile = 0; tile < tileCount; tile++)
+		{
+			int y = tile * coreSize;
 
-			nwk.ForwardTransmit();
+			float_n* outY = nwk.GetOutput(tile);
+			float_n* outU = nwk.GetOutput(tileCount + tile);
+			float_n* outV = nwk.GetOutput(tileCount * 2 + tile);
 
 			for (int _x = 0; _x < coreSize; _x++)
 			{
 				for (int _y = 0; _y < coreSize; _y++)
 				{
-					output_v.Get(x + _x, y + _y) = nwk.outLayer.value[_y * coreSize + _x] - 0.5;
+					output_y.Get(x + _x, y + _y) = outY[_y * coreSize + _x];
+					output_u.Get(x + _x, y + _y) = outU[_y * coreSize + _x] - 0.5;
+					output_v.Get(x + _x, y + _y) = outV[_y * coreSize + _x] - 0.5;
 				}
 			}
 		}
+	};
+
+#pragma omp parallel for
+	for (int x = 0; x < newWidth; x += coreSize)
+	{
+		int threadnum = omp_get_thread_num();
+
+		if (quantizedPtr)
+			scaleColumn(*quantizedNetworks[threadnum], x);
+		else if (halfPtr)
+			scaleColumn(*halfNetworks[threadnum], x);
+		else
+			scaleColumn(*tempNetworks[threadnum], x);
 
 		progress += coreSize;
 
@@ -299,6 +851,16 @@ void Scale()
 		item->FreeData();
 		delete item;
 	}
+	for (auto& item : quantizedNetworks)
+	{
+		item->FreeData();
+		delete item;
+	}
+	for (auto& item : halfNetworks)
+	{
+		item->FreeData();
+		delete item;
+	}
 	yLayer.FreeData();
 	uLayer.FreeData();
 	vLayer.FreeData();
@@ -330,6 +892,9 @@ void Load()
 
 	std::cout << "Working..." << std::endl;
 
+	DropInferenceNetworks();
+	DropEvaluator();
+
 	ProcessState state = Network::NetworkDataParser::ReadNetworkDataJSON(&networkPtr, path);
 	if (!state.success)
 	{
@@ -359,6 +924,176 @@ void Save()
 	std::cout << "Done." << std::endl;
 }
 
+void SaveHalf()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	std::string path, name;
+	HalfFormat format;
+	std::cout << "Path> ";
+	std::cin >> path;
+	std::cout << "Format(fp16/bf16)> ";
+	std::cin >> name;
+
+	if (!ParseHalfFormat(name, format))
+	{
+		std::cout << "Unknown format!" << std::endl;
+		return;
+	}
+
+	std::cout << "Working..." << std::endl;
+	Network::NetworkDataParser::SaveNetworkDataJSON(networkPtr, path, format);
+	std::cout << "Done." << std::endl;
+}
+
+// Transmit every sample through both the float network and batch, print the difference and timings
+template<typename Batch>
+void CompareWithFloat(Batch& batch, const std::string& name)
+{
+	const int batchSize = batch.batchSize;
+	const int outCount = networkPtr->outNeuronCount;
+	std::vector<float> reference((size_t)patches.Count() * outCount);
+
+	Network::Connectivity::FullConnNetworkBatch floatBatch(networkPtr, batchSize);
+
+	ProgressTimer timer;
+	for (int first = 0; first < patches.Count(); first += batchSize)
+	{
+		int size = std::min(batchSize, patches.Count() - first);
+
+		for (int i = 0; i < size; i++)
+			floatBatch.PushData(i, patches.Sd(first + i));
+
+		floatBatch.ForwardTransmit(size);
+
+		for (int i = 0; i < size; i++)
+			memcpy(&reference[(size_t)(first + i) * outCount], floatBatch.GetOutput(i), sizeof(float) * outCount);
+	}
+	auto floatTime = timer.Count();
+
+	double squaredError = 0.0;
+
+	timer.Reset();
+	for (int first = 0; first < patches.Count(); first += batchSize)
+	{
+		int size = std::min(batchSize, patches.Count() - first);
+
+		for (int i = 0; i < size; i++)
+			batch.PushData(i, patches.Sd(first + i));
+
+		batch.ForwardTransmit(size);
+
+		for (int i = 0; i < size; i++)
+		{
+			float* output = batch.GetOutput(i);
+			float* expected = &reference[(size_t)(first + i) * outCount];
+
+			for (int j = 0; j < outCount; j++)
+				squaredError += (output[j] - expected[j]) * (output[j] - expected[j]);
+		}
+	}
+	auto time = timer.Count();
+
+	floatBatch.FreeData();
+
+	// pixel values span [0, 1]
+	double mse = squaredError / ((double)patches.Count() * outCount);
+	std::cout << std::format("PSNR vs float: {:.2f}dB", mse > 0.0 ? 10.0 * log10(1.0 / mse) : INFINITY) << std::endl;
+	std::cout << std::format("Float: {}us, {}: {}us", floatTime / 1000, name, time / 1000) << std::endl;
+}
+
+void Quantize()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	if (patches.Empty())
+	{
+		std::cout << "No dataset loaded, needed for calibration!" << std::endl;
+		return;
+	}
+
+	int count;
+	std::cout << "Calibration-Samples> ";
+	std::cin >> count;
+	count = std::clamp(count, 1, patches.Count());
+
+	std::cout << "Working..." << std::endl;
+
+	DropInferenceNetworks();
+
+	// spread calibration samples over the whole dataset
+	std::vector<Network::float_n*> samples;
+	for (int i = 0; i < count; i++)
+		samples.push_back(patches.Sd((int)((size_t)i * patches.Count() / count)));
+
+	quantizedPtr = new Network::Connectivity::QuantizedNetwork(networkPtr, samples);
+
+	Network::Connectivity::QuantizedNetworkBatch quantizedBatch(quantizedPtr, 256);
+	CompareWithFloat(quantizedBatch, std::format("Int8 ({})", VectorAccelator::HasVNNI() ? "VNNI" : "maddubs"));
+	quantizedBatch.FreeData();
+
+	std::cout << "Done." << std::endl;
+}
+
+void Half()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	std::string name;
+	HalfFormat format;
+	std::cout << "Format(fp16/bf16)> ";
+	std::cin >> name;
+
+	if (!ParseHalfFormat(name, format))
+	{
+		std::cout << "Unknown format!" << std::endl;
+		return;
+	}
+
+	std::cout << "Working..." << std::endl;
+
+	DropInferenceNetworks();
+
+	halfPtr = new Network::Connectivity::HalfNetwork(networkPtr, format);
+
+	if (!patches.Empty())
+	{
+		Network::Connectivity::HalfNetworkBatch halfBatch(halfPtr, 256);
+		CompareWithFloat(halfBatch, name);
+		halfBatch.FreeData();
+	}
+
+	std::cout << "Done." << std::endl;
+}
+
+void EvaluateNetwork()
+{
+	if (!networkPtr)
+	{
+		std::cout << "No network loaded!" << std::endl;
+		return;
+	}
+
+	std::cout << "Working..." << std::endl;
+
+	auto result = Evaluate();
+	std::cout << std::format("Avg Loss: {}, PSNR: {:.2f}dB, Samples: {}, Throughput: {:.0f} samples/s", result.loss, result.psnr, result.sampleCount, result.samplesPerSecond) << std::endl;
+
+	std::cout << "Done." << std::endl;
+}
+
 void AddDataset()
 {
 	std::string path;
@@ -370,7 +1105,132 @@ void AddDataset()
 	std::cin >> count;
 
 	std::cout << "Working..." << std::endl;
-	GenDataset(datasets, path, count, coreSize, Channels_Y);
+	GenDataset(patches, path, count, coreSize, Channels_Y);
+	std::cout << "Done." << std::endl;
+}
+
+// Many images at once, decoded and sampled on every core
+void AddDatasets()
+{
+	std::string pattern;
+	int count, threadCount;
+
+	std::cout << "Paths(directory, glob or @list file)> ";
+	std::cin >> pattern;
+	std::cout << "Count per Image> ";
+	std::cin >> count;
+	std::cout << "Threads(0 for all cores)> ";
+	std::cin >> threadCount;
+
+	std::vector<std::string> paths = ExpandPaths(pattern);
+	if (paths.empty())
+	{
+		std::cout << "No image found!" << std::endl;
+		return;
+	}
+
+	std::cout << std::format("Working on {} images...", paths.size()) << std::endl;
+
+	ProgressTimer timer;
+	auto errors = GenDatasets(patches, paths, count, coreSize, Channels_Y, threadCount, [](int done, int total)
+	{
+		if (done % 50 == 0 || done == total)
+			DisplayProgress((float)done / total);
+	});
+	auto time = timer.Count();
+
+	std::cout << std::endl;
+	for (auto& item : errors)
+		std::cout << "Skipped " << item << std::endl;
+
+	std::cout << std::format("{} images, {} patches in {}ms", paths.size() - errors.size(), (paths.size() - errors.size()) * count, time / 1000000) << std::endl;
+	std::cout << "Done." << std::endl;
+}
+
+// Patches of this session to a cache file, so later sessions skip decoding
+void SaveCache()
+{
+	std::string path, name;
+	std::cout << "Path> ";
+	std::cin >> path;
+	std::cout << "Format(float/uint8)> ";
+	std::cin >> name;
+
+	PatchFormat format;
+	if (name == "float")
+		format = PatchFormat::Float;
+	else if (name == "uint8")
+		format = PatchFormat::UInt8;
+	else
+	{
+		std::cout << "Unknown format!" << std::endl;
+		return;
+	}
+
+	std::cout << "Working..." << std::endl;
+
+	ProcessState state = patches.Save(path, format);
+	if (!state.success)
+	{
+		std::cout << "Failed. Message: " << state.msg << std::endl;
+		return;
+	}
+
+	std::cout << std::format("{} patches saved.", patches.Count()) << std::endl;
+}
+
+// Replaces the patches with a cache file, a float cache is mapped rather than read
+void LoadCache()
+{
+	std::string path;
+	std::cout << "Path> ";
+	std::cin >> path;
+
+	ProgressTimer timer;
+	ProcessState state = patches.Open(path);
+	if (!state.success)
+	{
+		std::cout << "Failed. Message: " << state.msg << std::endl;
+		return;
+	}
+
+	std::cout << std::format("{} patches opened in {}ms.", patches.Count(), timer.Count() / 1000000) << std::endl;
+}
+
+// Lazy mode: keep the decoded planes only, training cuts fresh patches from them every epoch
+void LazyDataset()
+{
+	std::string pattern;
+	int count, threadCount;
+
+	std::cout << "Paths(file, directory, glob or @list file)> ";
+	std::cin >> pattern;
+	std::cout << "Patches per Epoch> ";
+	std::cin >> count;
+	std::cout << "Threads(0 for all cores)> ";
+	std::cin >> threadCount;
+
+	if (count <= 0)
+	{
+		std::cout << "Invalid patch count!" << std::endl;
+		return;
+	}
+
+	std::vector<std::string> paths = ExpandPaths(pattern);
+	if (paths.empty())
+	{
+		std::cout << "No image found!" << std::endl;
+		return;
+	}
+
+	std::cout << std::format("Working on {} images...", paths.size()) << std::endl;
+
+	for (auto& item : source.Load(paths, Channels_Y, threadCount))
+		std::cout << "Skipped " << item << std::endl;
+
+	source.count = count;
+
+	std::cout << std::format("{} images, {:.1f}MB of planes, {} patches per epoch", source.Images(), source.Pixels() * sizeof(float) / 1048576.0, source.count) << std::endl;
 	std::cout << "Done." << std::endl;
 }
 
@@ -383,12 +1243,8 @@ void ClearDataset()
 	if (yes == "Yes")
 	{
 		std::cout << "Working..." << std::endl;
-		for (auto& data : datasets)
-		{
-			data->Free();
-		}
-		datasets.clear();
-		datasets.shrink_to_fit();
+		patches.Clear();
+		source.Clear();
 
 		std::cout << "Done." << std::endl;
 	}
@@ -401,6 +1257,7 @@ void ClearDataset()
 int main()
 {
 	std::cout << "Image Scaler by Stehsaer" << std::endl;
+	std::cout << "SIMD: " << VectorAccelator::GetLevelName(VectorAccelator::GetLevel()) << std::endl;
 	try
 	{
 		while (1)
@@ -413,6 +1270,34 @@ int main()
 			{
 				Train();
 			}
+			else if (command == "train_async")
+			{
+				TrainAsync();
+			}
+			else if (command == "bench_async")
+			{
+				BenchAsync();
+			}
+			else if (command == "train_distributed")
+			{
+				TrainDistributed();
+			}
+			else if (command == "optimizer")
+			{
+				SelectOptimizer();
+			}
+			else if (command == "precision")
+			{
+				SelectPrecision();
+			}
+			else if (command == "checkpoint")
+			{
+				Checkpoint();
+			}
+			else if (command == "seed")
+			{
+				Seed();
+			}
 			else if (command == "new")
 			{
 				NewNetwork();
@@ -429,10 +1314,42 @@ int main()
 			{
 				Save();
 			}
+			else if (command == "save_half")
+			{
+				SaveHalf();
+			}
+			else if (command == "quantize")
+			{
+				Quantize();
+			}
+			else if (command == "half")
+			{
+				Half();
+			}
+			else if (command == "evaluate")
+			{
+				EvaluateNetwork();
+			}
 			else if (command == "add_dataset")
 			{
 				AddDataset();
 			}
+			else if (command == "add_datasets")
+			{
+				AddDatasets();
+			}
+			else if (command == "save_cache")
+			{
+				SaveCache();
+			}
+			else if (command == "load_cache")
+			{
+				LoadCache();
+			}
+			else if (command == "lazy_dataset")
+			{
+				LazyDataset();
+			}
 			else if (command == "clear_dataset")
 			{
 				ClearDataset();
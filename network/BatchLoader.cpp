@@ -0,0 +1,148 @@
+#include "BatchLoader.h"
+#include "ProgressTimer.h"
+
+#include <algorithm>
+
+using namespace Network;
+using namespace Network::Connectivity;
+
+BatchLoader::BatchLoader(FullConnNetwork* network, int batchSize, int count, Fill fill, int depth, int threadCount)
+{
+	if (batchSize <= 0 || count < 0 || depth <= 0 || threadCount <= 0)
+		throw std::exception("Invalid Parameters");
+
+	this->count = count;
+	this->batchSize = batchSize;
+	this->fill = fill;
+
+	batchCount = (count + batchSize - 1) / batchSize;
+
+	// same row layout as the input and target of a FullConnNetworkBatch
+	inStride = AlignedStride(network->inNeuronCount);
+	outStride = AlignedStride(network->outNeuronCount);
+
+	// the minibatch in training, plus depth ahead of it
+	for (int i = 0; i < depth + 1; i++)
+		slots.push_back(Slot{ AlignedAlloc((size_t)batchSize * inStride), AlignedAlloc((size_t)batchSize * outStride), false });
+
+	current = nullptr;
+	next = released = 0;
+	quit = false;
+	stallTime = 0;
+
+	for (int i = 0; i < threadCount; i++)
+		threads.push_back(std::thread(&BatchLoader::LoaderMain, this));
+}
+
+BatchLoader::~BatchLoader()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	freeSignal.notify_all();
+
+	for (auto& item : threads)
+		item.join();
+
+	for (auto& item : slots)
+	{
+		AlignedFree(item.input);
+		AlignedFree(item.target);
+	}
+}
+
+int BatchLoader::Next()
+{
+	if (current)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			released++;
+		}
+		freeSignal.notify_all();
+
+		current = nullptr;
+	}
+
+	if (released >= batchCount)
+		return 0;
+
+	Slot& slot = slots[released % slots.size()];
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		if (!slot.ready && !error)
+		{
+			ProgressTimer timer;
+			readySignal.wait(guard, [&] { return slot.ready || error; });
+			stallTime += timer.Count();
+		}
+
+		if (error)
+			std::rethrow_exception(error);
+
+		slot.ready = false;
+	}
+
+	current = &slot;
+
+	return std::min(batchSize, count - released * batchSize);
+}
+
+float_n* BatchLoader::GetInput(int index)
+{
+	return current->input + (size_t)index * inStride;
+}
+
+float_n* BatchLoader::GetTarget(int index)
+{
+	return current->target + (size_t)index * outStride;
+}
+
+long long BatchLoader::StallTime()
+{
+	return stallTime;
+}
+
+void BatchLoader::LoaderMain()
+{
+	while (1)
+	{
+		int index;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			// a slot is free once Next is done with the minibatch it held before
+			freeSignal.wait(guard, [&] { return quit || error || next >= batchCount || next < released + (int)slots.size(); });
+
+			if (quit || error || next >= batchCount)
+				return;
+
+			index = next++;
+		}
+
+		Slot& slot = slots[index % slots.size()];
+		int first = index * batchSize;
+		int size = std::min(batchSize, count - first);
+
+		try
+		{
+			for (int i = 0; i < size; i++)
+				fill(first + i, slot.input + (size_t)i * inStride, slot.target + (size_t)i * outStride);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			slot.ready = true;
+		}
+		readySignal.notify_all();
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef _BATCH_LOADER_H_
+#define _BATCH_LOADER_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+#include "NetworkFramework.h"
+
+namespace Network
+{
+	// Assembles the next minibatches on helper threads while the current one trains
+	// A ring of slots, each an input and a target matrix laid out as those of a FullConnNetworkBatch,
+	// one slot holds the minibatch being trained and up to depth more are filled ahead of it
+	// Rows are read in place until the following Next, so handing a minibatch over copies nothing
+	class BatchLoader
+	{
+	public:
+		/// <summary>
+		/// Writes sample index, the input row and the target row of one sample, called on helper threads
+		/// </summary>
+		typedef std::function<void(int index, float_n* input, float_n* target)> Fill;
+
+		/// <summary>
+		/// Minibatches of batchSize samples over [0, count) for the input and output layers of network, loading starts right away
+		/// </summary>
+		BatchLoader(Connectivity::FullConnNetwork* network, int batchSize, int count, Fill fill, int depth = 4, int threadCount = 1);
+
+		/// <summary>
+		/// Stops the helper threads, minibatches not taken yet are dropped
+		/// </summary>
+		~BatchLoader();
+
+		BatchLoader(const BatchLoader&) = delete;
+		BatchLoader& operator=(const BatchLoader&) = delete;
+
+		/// <summary>
+		/// Release the current minibatch and wait for the next one to be assembled
+		/// Returns its sample count, 0 once every minibatch was taken. An exception of fill is rethrown here
+		/// </summary>
+		int Next();
+
+		// rows of a sample of the current minibatch
+		float_n* GetInput(int index);
+		float_n* GetTarget(int index);
+
+		/// <summary>
+		/// Time Next spent waiting for helper threads, in ns
+		/// </summary>
+		long long StallTime();
+
+	private:
+		struct Slot
+		{
+			float_n* input;
+			float_n* target;
+			bool ready;
+		};
+
+		int count, batchSize, batchCount;
+		int inStride, outStride;
+		Fill fill;
+
+		std::vector<Slot> slots; // minibatch k in slot k % slots.size()
+		Slot* current; // minibatch handed out by the last Next, nullptr before the first one
+		int next; // first minibatch not claimed by a helper
+		int released; // minibatches Next is done with
+
+		std::vector<std::thread> threads;
+		std::mutex lock;
+		std::condition_variable readySignal, freeSignal;
+		bool quit;
+		std::exception_ptr error;
+
+		long long stallTime;
+
+		void LoaderMain();
+	};
+}
+
+#endif
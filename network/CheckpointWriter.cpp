@@ -0,0 +1,202 @@
+#include "CheckpointWriter.h"
+#include "NetworkDataParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <format>
+#include <filesystem>
+#include <string.h>
+#include <vector>
+
+using namespace Network;
+using namespace Network::Connectivity;
+
+// Sequence numbers of the <prefix>-<sequence>.json files already on disk, ascending
+static std::vector<std::pair<int, std::string>> FindCheckpoints(const std::string& prefix)
+{
+	std::vector<std::pair<int, std::string>> found;
+
+	std::filesystem::path base(prefix);
+	std::filesystem::path folder = base.has_parent_path() ? base.parent_path() : std::filesystem::path(".");
+	std::string head = base.filename().string() + "-";
+
+	std::error_code error;
+	for (auto& entry : std::filesystem::directory_iterator(folder, error))
+	{
+		std::string name = entry.path().filename().string();
+
+		if (name.size() <= head.size() + 5 || name.compare(0, head.size(), head) != 0 || name.compare(name.size() - 5, 5, ".json") != 0)
+			continue;
+
+		std::string digits = name.substr(head.size(), name.size() - head.size() - 5);
+		if (digits.size() > 9 || digits.find_first_not_of("0123456789") != std::string::npos)
+			continue;
+
+		found.emplace_back(std::stoi(digits), std::format("{}-{}.json", prefix, digits));
+	}
+
+	std::sort(found.begin(), found.end());
+	return found;
+}
+
+CheckpointWriter::CheckpointWriter(FullConnNetwork* src, std::string prefix, int keepCount, int batchInterval, int seconds) :lastState(true)
+{
+	if (keepCount <= 0 || batchInterval < 0 || seconds < 0)
+		throw std::exception("Invalid Parameters");
+
+	source = src;
+	copy = new FullConnNetwork(src->inNeuronCount, src->outNeuronCount, src->hiddenNeuronCount, src->hiddenLayerCount, src->ActivateFunc, 0.0, src->outLayerSoftMax);
+
+	this->prefix = prefix;
+	this->keepCount = keepCount;
+	this->batchInterval = batchInterval;
+	this->seconds = seconds;
+
+	batches = 0;
+	pending = false;
+	quit = false;
+	sequence = 0;
+	written = 0;
+
+	// a resumed run numbers on from the previous one, and its checkpoints count towards keepCount
+	for (auto& [number, path] : FindCheckpoints(prefix))
+	{
+		sequence = number;
+		files.push_back(path);
+	}
+
+	writer = std::thread(&CheckpointWriter::WriterMain, this);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	signal.notify_all();
+
+	writer.join();
+
+	copy->Destroy();
+	delete copy;
+}
+
+void CheckpointWriter::Tick()
+{
+	batches++;
+
+	bool due = (batchInterval > 0 && batches >= batchInterval) || (seconds > 0 && timer.Count() >= seconds * 1000000000ll);
+
+	if (due && Snapshot())
+	{
+		batches = 0;
+		timer.Reset();
+	}
+}
+
+static void CopyLayer(NeuronLayer& dst, NeuronLayer& src)
+{
+	// padding included, one copy per layer
+	memcpy(dst.weights, src.weights, sizeof(float_n) * src.neuronCount * src.stride);
+	dst.bias = std::atomic_ref<float_n>(src.bias).load(std::memory_order_relaxed);
+}
+
+bool CheckpointWriter::Snapshot()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (pending)
+			return false;
+	}
+
+	// the writer is idle, the copy is ours until pending is set
+	CopyLayer(copy->outLayer, source->outLayer);
+	for (int i = 0; i < source->hiddenLayerCount; i++)
+		CopyLayer(copy->hiddenLayerList[i], source->hiddenLayerList[i]);
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending = true;
+		sequence++;
+	}
+	signal.notify_all();
+
+	return true;
+}
+
+void CheckpointWriter::Wait()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	signal.wait(guard, [this] { return !pending; });
+}
+
+int CheckpointWriter::Written()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return written;
+}
+
+ProcessState CheckpointWriter::LastState()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return lastState;
+}
+
+void CheckpointWriter::WriterMain()
+{
+	while (1)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			signal.wait(guard, [this] { return quit || pending; });
+
+			// a snapshot taken before quitting is still written
+			if (!pending)
+				return;
+		}
+
+		Write();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			pending = false;
+		}
+		signal.notify_all();
+	}
+}
+
+void CheckpointWriter::Write()
+{
+	std::string path = std::format("{}-{}.json", prefix, sequence);
+	std::string temp = path + ".tmp";
+
+	// written under a temporary name first, a crash never leaves a truncated checkpoint behind
+	ProcessState state = NetworkDataParser::SaveNetworkDataJSONBinary(copy, temp);
+
+	if (state.success)
+	{
+		std::error_code error;
+		std::filesystem::rename(temp, path, error);
+
+		if (error)
+			state = ProcessState(false, "Failed to rename checkpoint: " + error.message());
+	}
+
+	if (state.success)
+	{
+		files.push_back(path);
+
+		while (files.size() > (size_t)keepCount)
+		{
+			std::error_code error;
+			std::filesystem::remove(files.front(), error);
+			files.pop_front();
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	lastState = state;
+	if (state.success)
+		written++;
+}
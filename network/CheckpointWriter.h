@@ -0,0 +1,79 @@
+#ifndef _CHECKPOINT_WRITER_H_
+#define _CHECKPOINT_WRITER_H_
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "NetworkFramework.h"
+#include "ProcessState.h"
+#include "ProgressTimer.h"
+
+namespace Network
+{
+	// Periodic checkpoints of a network while it trains
+	// A snapshot copies the weights into a spare network between batches, a background thread serializes the copy,
+	// so training only pauses for the copy. Files are named <prefix>-<sequence>.json, the newest keepCount are kept
+	// Checkpoints already on disk under the prefix are picked up, numbering continues after the highest and they are pruned alike
+	class CheckpointWriter
+	{
+	public:
+		/// <summary>
+		/// batchInterval and seconds of 0 disable that trigger
+		/// </summary>
+		CheckpointWriter(Connectivity::FullConnNetwork* src, std::string prefix, int keepCount, int batchInterval, int seconds);
+
+		/// <summary>
+		/// Finishes the write in flight, if any
+		/// </summary>
+		~CheckpointWriter();
+
+		CheckpointWriter(const CheckpointWriter&) = delete;
+		CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+		/// <summary>
+		/// Call after every batch from the training thread, takes a snapshot when one is due
+		/// A due snapshot waits for the next tick while the previous one is still being written, training never blocks on disk
+		/// </summary>
+		void Tick();
+
+		/// <summary>
+		/// Copy the weights and hand them to the writer, false if the writer is still busy
+		/// </summary>
+		bool Snapshot();
+
+		/// <summary>
+		/// Block until the writer is idle
+		/// </summary>
+		void Wait();
+
+		int Written();
+		ProcessState LastState();
+
+	private:
+		Connectivity::FullConnNetwork* source;
+		Connectivity::FullConnNetwork* copy; // written by Snapshot only while the writer is idle
+
+		std::string prefix;
+		int keepCount;
+		std::deque<std::string> files; // oldest first
+
+		int batchInterval, seconds;
+		int batches; // since the last snapshot
+		ProgressTimer timer;
+
+		std::thread writer;
+		std::mutex lock;
+		std::condition_variable signal;
+		bool pending, quit;
+		int sequence, written;
+		ProcessState lastState;
+
+		void WriterMain();
+		void Write();
+	};
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "Deterministic.h"
+
+#include <mutex>
+
+using namespace Network;
+
+static std::mutex lock;
+static bool seeded = false;
+static unsigned int seed = 0;
+static unsigned int taken[(int)RandomStream::Count] = {}; // engines handed out by each stream since Enable
+
+void Network::Deterministic::Enable(unsigned int value)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	seeded = true;
+	seed = value;
+
+	for (auto& item : taken)
+		item = 0;
+}
+
+void Network::Deterministic::Disable()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	seeded = false;
+}
+
+bool Network::Deterministic::Enabled()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return seeded;
+}
+
+unsigned int Network::Deterministic::Seed()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return seed;
+}
+
+std::mt19937 Network::Deterministic::Engine(RandomStream stream)
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	if (!seeded)
+	{
+		guard.unlock();
+		return std::mt19937(std::random_device{}());
+	}
+
+	// seed_seq spreads the three words over the whole engine state, so neighbouring engines are unrelated
+	std::seed_seq sequence{ seed, (unsigned int)stream, taken[(int)stream]++ };
+	return std::mt19937(sequence);
+}
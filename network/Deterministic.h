@@ -0,0 +1,43 @@
+#ifndef _DETERMINISTIC_H_
+#define _DETERMINISTIC_H_
+
+#include <random>
+
+namespace Network
+{
+	// Random streams of training, kept apart so draws from one never shift another
+	enum class RandomStream : int
+	{
+		Init, // weight initialization
+		Shuffle, // sample order of every epoch
+		Patch, // patch positions of generated datasets
+		Estimate, // subsamples of loss estimates
+		Count
+	};
+
+	// Seeded mode for reproducible runs: every random stream derives from one seed,
+	// and TrainAsync steps its workers in lockstep with a fixed reduction tree instead of Hogwild-style
+	// Runs with the same seed, thread count and sequence of commands are bit-identical
+	namespace Deterministic
+	{
+		/// <summary>
+		/// Enter seeded mode, every stream restarts from the seed
+		/// </summary>
+		void Enable(unsigned int seed);
+
+		/// <summary>
+		/// Back to engines seeded from std::random_device and Hogwild-style TrainAsync
+		/// </summary>
+		void Disable();
+
+		bool Enabled();
+		unsigned int Seed();
+
+		/// <summary>
+		/// A new engine of a stream, in seeded mode the n-th engine taken from a stream is the same on every run
+		/// </summary>
+		std::mt19937 Engine(RandomStream stream);
+	}
+}
+
+#endif
@@ -2,6 +2,17 @@
 #include <iostream>
 #include <fstream>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace std::filesystem;
 
 File::File(std::string _path)
@@ -98,6 +109,105 @@ bool File::ReadAllText(std::string* dst)
 		return false;
 }
 
+MappedFile::MappedFile()
+{
+	data = nullptr;
+	size = 0;
+
+#ifdef _WIN32
+	file = mapping = nullptr;
+#else
+	file = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(std::string path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	file = handle;
+
+	LARGE_INTEGER length;
+	if (!GetFileSizeEx(handle, &length) || length.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		Close();
+		return false;
+	}
+
+	data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	size = (size_t)length.QuadPart;
+#else
+	file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	data = view == MAP_FAILED ? nullptr : (unsigned char*)view;
+	size = (size_t)info.st_size;
+#endif
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+
+	file = mapping = nullptr;
+#else
+	if (data) munmap(data, size);
+	if (file >= 0) close(file);
+
+	file = -1;
+#endif
+
+	data = nullptr;
+	size = 0;
+}
+
+unsigned char* MappedFile::Data()
+{
+	return data;
+}
+
+size_t MappedFile::Size()
+{
+	return size;
+}
+
 FileInfo::FileInfo(std::string path)
 {
 	std::filesystem::path pth(path);
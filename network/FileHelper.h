@@ -24,6 +24,35 @@ public:
 	bool WriteAllBytes(unsigned char* src, size_t size);
 };
 
+// Copy-on-write mapping of a whole file: pages are shared with the page cache and every other process
+// mapping the file until written to, writes never reach the file
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(std::string path);
+	void Close();
+
+	unsigned char* Data();
+	size_t Size();
+
+private:
+	unsigned char* data;
+	size_t size;
+
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+};
+
 struct FileInfo
 {
 public:
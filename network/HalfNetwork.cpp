@@ -0,0 +1,134 @@
+#include "HalfNetwork.h"
+#include "MatrixAccelator.h"
+
+#include <string.h>
+#include <algorithm>
+
+using namespace Network;
+using namespace Network::Connectivity;
+using namespace Network::Algorithm;
+
+Network::HalfLayer::HalfLayer(NeuronLayer& layer, HalfFormat format)
+{
+	prevCount = layer.prevCount;
+	neuronCount = layer.neuronCount;
+	stride = layer.stride;
+	bias = layer.bias;
+
+	// padding columns convert from zeros to zeros
+	size_t count = (size_t)neuronCount * stride;
+	weights = (unsigned short*)AlignedAlloc((count + 1) / 2);
+	VectorAccelator::FloatToHalf(layer.weights, weights, count, format);
+}
+
+unsigned short* Network::HalfLayer::operator[](int index)
+{
+	return weights + (size_t)index * stride;
+}
+
+void Network::HalfLayer::Free()
+{
+	AlignedFree((float_n*)weights);
+	weights = nullptr;
+}
+
+HalfNetwork::HalfNetwork(FullConnNetwork* network, HalfFormat format)
+{
+	if (network->outLayerSoftMax)
+		throw std::exception("SoftMax Not Supported!");
+
+	ActivateFunc = network->ActivateFunc;
+	this->format = format;
+
+	inNeuronCount = network->inNeuronCount;
+	outNeuronCount = network->outNeuronCount;
+
+	for (auto& layer : network->hiddenLayerList)
+		hiddenLayerList.push_back(HalfLayer(layer, format));
+
+	outLayer = HalfLayer(network->outLayer, format);
+}
+
+void HalfNetwork::Destroy()
+{
+	for (auto& layer : hiddenLayerList)
+		layer.Free();
+
+	hiddenLayerList.clear();
+	outLayer.Free();
+}
+
+HalfNetworkBatch::HalfNetworkBatch(HalfNetwork* src, int batchSize)
+{
+	if (batchSize <= 0)
+		throw std::exception("Invalid Parameters");
+
+	source = src;
+	this->batchSize = batchSize;
+
+	inStride = AlignedStride(source->inNeuronCount);
+	outStride = AlignedStride(source->outNeuronCount);
+
+	int widest = 0;
+	for (auto& layer : source->hiddenLayerList)
+		widest = std::max(widest, layer.neuronCount);
+
+	valueStride = AlignedStride(widest);
+
+	input = AlignedAlloc((size_t)batchSize * inStride);
+	output = AlignedAlloc((size_t)batchSize * outStride);
+	value[0] = AlignedAlloc((size_t)batchSize * valueStride);
+	value[1] = AlignedAlloc((size_t)batchSize * valueStride);
+}
+
+void HalfNetworkBatch::PushData(int index, float_n* data)
+{
+	memcpy(GetInput(index), data, sizeof(float_n) * source->inNeuronCount);
+}
+
+float_n* HalfNetworkBatch::GetInput(int index)
+{
+	return input + (size_t)index * inStride;
+}
+
+float_n* HalfNetworkBatch::GetOutput(int index)
+{
+	return output + (size_t)index * outStride;
+}
+
+void HalfNetworkBatch::FreeData()
+{
+	AlignedFree(input);
+	AlignedFree(output);
+	AlignedFree(value[0]);
+	AlignedFree(value[1]);
+}
+
+void HalfNetworkBatch::ForwardTransmitLayer(HalfLayer& layer, float_n* in, int inRowStride, float_n* out, int outRowStride, ActivateFunctionType type, int count)
+{
+	MatrixEpilogue epilogue = LayerEpilogue(type, 1.0f / (float_n)layer.prevCount, layer.bias / (float_n)layer.prevCount);
+
+	// out = f((in * weights^T + bias) / prevCount), weights widened panel by panel
+	MatrixAccelator::Gemm(MatrixOp::NoTrans, MatrixOp::Trans, count, layer.neuronCount, layer.prevCount,
+		1.0f, in, inRowStride, layer[0], source->format, layer.stride,
+		0.0f, out, outRowStride, &epilogue);
+}
+
+void HalfNetworkBatch::ForwardTransmit(int count)
+{
+	if (count > batchSize)
+		throw std::exception("Batch Overflow!");
+
+	float_n* in = input;
+	int stride = inStride;
+
+	for (int i = 0; i < source->hiddenLayerList.size(); i++)
+	{
+		ForwardTransmitLayer(source->hiddenLayerList[i], in, stride, value[i % 2], valueStride, source->ActivateFunc, count);
+
+		in = value[i % 2];
+		stride = valueStride;
+	}
+
+	ForwardTransmitLayer(source->outLayer, in, stride, output, outStride, ActivateFunctionType::Linear, count);
+}
@@ -0,0 +1,86 @@
+#ifndef _HALF_NETWORK_H_
+#define _HALF_NETWORK_H_
+
+#include <vector>
+
+#include "NetworkStructure.h"
+#include "NetworkAlgorithm.h"
+#include "NetworkFramework.h"
+#include "VectorAccelator.h"
+
+namespace Network
+{
+	// 16-bit copy of a NeuronLayer's weights for inference, same layout as NeuronLayer::weights
+	class HalfLayer
+	{
+	public:
+		unsigned short* weights; // row-major, neuronCount rows of stride elements
+		int stride;
+
+		int prevCount;
+		int neuronCount;
+
+		float_n bias;
+
+		/// <summary>
+		/// Narrow the weights of a layer to 16 bits, rounding to nearest even
+		/// </summary>
+		HalfLayer(NeuronLayer& layer, HalfFormat format);
+		HalfLayer() :weights(nullptr), stride(0), prevCount(0), neuronCount(0), bias(0) {}
+
+		unsigned short* operator[](int index);
+
+		void Free();
+	};
+
+	namespace Connectivity
+	{
+		// Inference copy of a FullConnNetwork with FP16 or BF16 weights
+		// Halves the weight footprint, products are still accumulated in float
+		class HalfNetwork
+		{
+		public:
+			ActivateFunctionType ActivateFunc;
+			HalfFormat format;
+
+			int inNeuronCount, outNeuronCount;
+
+			std::vector<HalfLayer> hiddenLayerList;
+			HalfLayer outLayer;
+
+			HalfNetwork(FullConnNetwork* network, HalfFormat format);
+
+			void Destroy();
+		};
+
+		// Transmits a batch of samples through a HalfNetwork, mirrors FullConnNetworkBatch
+		class HalfNetworkBatch
+		{
+		public:
+			HalfNetwork* source;
+
+			int batchSize; // capacity, in samples
+			int inStride, outStride, valueStride;
+
+			float_n* input; // row-major, one row of inStride elements per sample
+			float_n* output; // row-major, one row of outStride elements per sample
+			float_n* value[2]; // activations of hidden layers, alternating, one row of valueStride per sample
+
+			HalfNetworkBatch(HalfNetwork* src, int batchSize);
+
+			// Data Management
+
+			void PushData(int index, float_n* data);
+			float_n* GetInput(int index);
+			float_n* GetOutput(int index);
+			void FreeData();
+
+			// Transmission
+
+			void ForwardTransmit(int count);
+			void ForwardTransmitLayer(HalfLayer& layer, float_n* in, int inRowStride, float_n* out, int outRowStride, ActivateFunctionType type, int count);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,1016 @@
+#include "MatrixAccelator.h"
+#include "VectorAccelator.h"
+#include "NetworkStructure.h"
+#include "SIMDTarget.h"
+#include "SIMDMath.h"
+
+#include <omp.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+// Products smaller than this (in multiply-adds) stay on the calling thread
+static const long long ParallelThreshold = 1LL << 18;
+
+// Set on threads that already run in parallel outside of OpenMP
+static thread_local bool threadSerial = false;
+
+// Largest register tile of all micro-kernels
+static const int MaxTileSize = 6 * 32;
+
+typedef void (*MicroKernel)(int kc, const float* a, const float* b, float* c, int ldc, float alpha, float beta, const MatrixEpilogue* epilogue);
+
+struct GemmConfig
+{
+	int MR, NR; // register tile, rows of A panels x columns of B panels
+	int MC, KC, NC; // cache blocks: A block sits in L2, B panel in L1
+	MicroKernel kernel;
+};
+
+// Grow-only packing buffer, one per calling thread
+struct PackBuffer
+{
+	float* data = nullptr;
+	size_t capacity = 0;
+
+	float* Reserve(size_t count)
+	{
+		if (count > capacity)
+		{
+			Network::AlignedFree(data);
+			data = Network::AlignedAlloc(count);
+			capacity = count;
+		}
+		return data;
+	}
+
+	~PackBuffer()
+	{
+		Network::AlignedFree(data);
+	}
+};
+
+static thread_local PackBuffer packBufferA, packBufferB;
+
+// ---------- Epilogues ----------
+
+static void ApplyEpilogue(const MatrixEpilogue& epilogue, float* y, int count)
+{
+	const float scale = epilogue.scale, shift = epilogue.shift;
+
+	switch (epilogue.activation)
+	{
+	case EpilogueActivation::ReLU:
+		for (int i = 0; i < count; i++)
+			y[i] = std::max(y[i] * scale + shift, 0.0f);
+		break;
+	case EpilogueActivation::LeakyReLU:
+		for (int i = 0; i < count; i++)
+		{
+			float v = y[i] * scale + shift;
+			y[i] = std::max(v, v * epilogue.slope);
+		}
+		break;
+	case EpilogueActivation::Sigmoid:
+	case EpilogueActivation::SigmoidShifted:
+		for (int i = 0; i < count; i++)
+			y[i] = y[i] * scale + shift;
+
+		VectorAccelator::Sigmoid(y, count);
+
+		if (epilogue.activation == EpilogueActivation::SigmoidShifted)
+			for (int i = 0; i < count; i++)
+				y[i] = y[i] * 2.0f - 1.0f;
+		break;
+	default:
+		for (int i = 0; i < count; i++)
+			y[i] = y[i] * scale + shift;
+		break;
+	}
+}
+
+#ifdef VA_X86
+
+TARGET_AVX2 static inline __m256 ApplyEpilogue_AVX2(const MatrixEpilogue& epilogue, __m256 v)
+{
+	v = _mm256_fmadd_ps(v, _mm256_set1_ps(epilogue.scale), _mm256_set1_ps(epilogue.shift));
+
+	switch (epilogue.activation)
+	{
+	case EpilogueActivation::ReLU:
+		return _mm256_max_ps(v, _mm256_setzero_ps());
+	case EpilogueActivation::LeakyReLU:
+		return _mm256_max_ps(v, _mm256_mul_ps(v, _mm256_set1_ps(epilogue.slope)));
+	case EpilogueActivation::Sigmoid:
+		return Sigmoid8_AVX2(v);
+	case EpilogueActivation::SigmoidShifted:
+		return _mm256_fmsub_ps(Sigmoid8_AVX2(v), _mm256_set1_ps(2.0f), _mm256_set1_ps(1.0f));
+	default:
+		return v;
+	}
+}
+
+TARGET_AVX512 static inline __m512 ApplyEpilogue_AVX512(const MatrixEpilogue& epilogue, __m512 v)
+{
+	v = _mm512_fmadd_ps(v, _mm512_set1_ps(epilogue.scale), _mm512_set1_ps(epilogue.shift));
+
+	switch (epilogue.activation)
+	{
+	case EpilogueActivation::ReLU:
+		return _mm512_max_ps(v, _mm512_setzero_ps());
+	case EpilogueActivation::LeakyReLU:
+		return _mm512_max_ps(v, _mm512_mul_ps(v, _mm512_set1_ps(epilogue.slope)));
+	case EpilogueActivation::Sigmoid:
+		return Sigmoid16_AVX512(v);
+	case EpilogueActivation::SigmoidShifted:
+		return _mm512_fmsub_ps(Sigmoid16_AVX512(v), _mm512_set1_ps(2.0f), _mm512_set1_ps(1.0f));
+	default:
+		return v;
+	}
+}
+
+#endif
+
+// ---------- Micro-kernels ----------
+// c[MR x NR] = alpha * sum(a[k] * b[k]^T) + beta * c, a and b are packed panels
+// The epilogue, if given, is applied before c is stored (SIMD kernels) or right after (scalar and SSE)
+
+static void MicroKernel_Scalar(int kc, const float* a, const float* b, float* c, int ldc, float alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	float acc[4][4] = {};
+
+	for (int k = 0; k < kc; k++, a += 4, b += 4)
+		for (int r = 0; r < 4; r++)
+			for (int j = 0; j < 4; j++)
+				acc[r][j] += a[r] * b[j];
+
+	for (int r = 0; r < 4; r++)
+	{
+		for (int j = 0; j < 4; j++)
+			c[r * ldc + j] = alpha * acc[r][j] + (beta == 0.0f ? 0.0f : beta * c[r * ldc + j]);
+
+		if (epilogue) ApplyEpilogue(*epilogue, c + r * ldc, 4);
+	}
+}
+
+#ifdef VA_X86
+
+TARGET_SSE static inline void StoreRow_SSE(float* c, __m128 v0, __m128 v1, __m128 alpha, float beta)
+{
+	v0 = _mm_mul_ps(v0, alpha);
+	v1 = _mm_mul_ps(v1, alpha);
+
+	if (beta != 0.0f)
+	{
+		__m128 b = _mm_set1_ps(beta);
+		v0 = _mm_add_ps(v0, _mm_mul_ps(b, _mm_loadu_ps(c)));
+		v1 = _mm_add_ps(v1, _mm_mul_ps(b, _mm_loadu_ps(c + 4)));
+	}
+
+	_mm_storeu_ps(c, v0);
+	_mm_storeu_ps(c + 4, v1);
+}
+
+// 4 x 8 tile
+TARGET_SSE static void MicroKernel_SSE(int kc, const float* a, const float* b, float* c, int ldc, float alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	__m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+	__m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+	__m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+	__m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+
+	for (int k = 0; k < kc; k++, a += 4, b += 8)
+	{
+		__m128 b0 = _mm_load_ps(b), b1 = _mm_load_ps(b + 4);
+		__m128 ar;
+
+		ar = _mm_set1_ps(a[0]); c00 = _mm_add_ps(c00, _mm_mul_ps(ar, b0)); c01 = _mm_add_ps(c01, _mm_mul_ps(ar, b1));
+		ar = _mm_set1_ps(a[1]); c10 = _mm_add_ps(c10, _mm_mul_ps(ar, b0)); c11 = _mm_add_ps(c11, _mm_mul_ps(ar, b1));
+		ar = _mm_set1_ps(a[2]); c20 = _mm_add_ps(c20, _mm_mul_ps(ar, b0)); c21 = _mm_add_ps(c21, _mm_mul_ps(ar, b1));
+		ar = _mm_set1_ps(a[3]); c30 = _mm_add_ps(c30, _mm_mul_ps(ar, b0)); c31 = _mm_add_ps(c31, _mm_mul_ps(ar, b1));
+	}
+
+	__m128 alphaVec = _mm_set1_ps(alpha);
+	StoreRow_SSE(c, c00, c01, alphaVec, beta);
+	StoreRow_SSE(c + ldc, c10, c11, alphaVec, beta);
+	StoreRow_SSE(c + 2 * ldc, c20, c21, alphaVec, beta);
+	StoreRow_SSE(c + 3 * ldc, c30, c31, alphaVec, beta);
+
+	if (epilogue)
+		for (int r = 0; r < 4; r++)
+			ApplyEpilogue(*epilogue, c + r * ldc, 8);
+}
+
+TARGET_AVX2 static inline void StoreRow_AVX2(float* c, __m256 v0, __m256 v1, __m256 alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	v0 = _mm256_mul_ps(v0, alpha);
+	v1 = _mm256_mul_ps(v1, alpha);
+
+	if (beta != 0.0f)
+	{
+		__m256 b = _mm256_set1_ps(beta);
+		v0 = _mm256_fmadd_ps(b, _mm256_loadu_ps(c), v0);
+		v1 = _mm256_fmadd_ps(b, _mm256_loadu_ps(c + 8), v1);
+	}
+
+	if (epilogue)
+	{
+		v0 = ApplyEpilogue_AVX2(*epilogue, v0);
+		v1 = ApplyEpilogue_AVX2(*epilogue, v1);
+	}
+
+	_mm256_storeu_ps(c, v0);
+	_mm256_storeu_ps(c + 8, v1);
+}
+
+// 6 x 16 tile, 12 accumulators
+TARGET_AVX2 static void MicroKernel_AVX2(int kc, const float* a, const float* b, float* c, int ldc, float alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+	__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+	__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+	__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+	__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+	__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+	for (int k = 0; k < kc; k++, a += 6, b += 16)
+	{
+		__m256 b0 = _mm256_load_ps(b), b1 = _mm256_load_ps(b + 8);
+		__m256 ar;
+
+		ar = _mm256_broadcast_ss(a); c00 = _mm256_fmadd_ps(ar, b0, c00); c01 = _mm256_fmadd_ps(ar, b1, c01);
+		ar = _mm256_broadcast_ss(a + 1); c10 = _mm256_fmadd_ps(ar, b0, c10); c11 = _mm256_fmadd_ps(ar, b1, c11);
+		ar = _mm256_broadcast_ss(a + 2); c20 = _mm256_fmadd_ps(ar, b0, c20); c21 = _mm256_fmadd_ps(ar, b1, c21);
+		ar = _mm256_broadcast_ss(a + 3); c30 = _mm256_fmadd_ps(ar, b0, c30); c31 = _mm256_fmadd_ps(ar, b1, c31);
+		ar = _mm256_broadcast_ss(a + 4); c40 = _mm256_fmadd_ps(ar, b0, c40); c41 = _mm256_fmadd_ps(ar, b1, c41);
+		ar = _mm256_broadcast_ss(a + 5); c50 = _mm256_fmadd_ps(ar, b0, c50); c51 = _mm256_fmadd_ps(ar, b1, c51);
+	}
+
+	__m256 alphaVec = _mm256_set1_ps(alpha);
+	StoreRow_AVX2(c, c00, c01, alphaVec, beta, epilogue);
+	StoreRow_AVX2(c + ldc, c10, c11, alphaVec, beta, epilogue);
+	StoreRow_AVX2(c + 2 * ldc, c20, c21, alphaVec, beta, epilogue);
+	StoreRow_AVX2(c + 3 * ldc, c30, c31, alphaVec, beta, epilogue);
+	StoreRow_AVX2(c + 4 * ldc, c40, c41, alphaVec, beta, epilogue);
+	StoreRow_AVX2(c + 5 * ldc, c50, c51, alphaVec, beta, epilogue);
+}
+
+TARGET_AVX512 static inline void StoreRow_AVX512(float* c, __m512 v0, __m512 v1, __m512 alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	v0 = _mm512_mul_ps(v0, alpha);
+	v1 = _mm512_mul_ps(v1, alpha);
+
+	if (beta != 0.0f)
+	{
+		__m512 b = _mm512_set1_ps(beta);
+		v0 = _mm512_fmadd_ps(b, _mm512_loadu_ps(c), v0);
+		v1 = _mm512_fmadd_ps(b, _mm512_loadu_ps(c + 16), v1);
+	}
+
+	if (epilogue)
+	{
+		v0 = ApplyEpilogue_AVX512(*epilogue, v0);
+		v1 = ApplyEpilogue_AVX512(*epilogue, v1);
+	}
+
+	_mm512_storeu_ps(c, v0);
+	_mm512_storeu_ps(c + 16, v1);
+}
+
+// 6 x 32 tile, 12 accumulators
+TARGET_AVX512 static void MicroKernel_AVX512(int kc, const float* a, const float* b, float* c, int ldc, float alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	__m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+	__m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+	__m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+	__m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+	__m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+	__m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+
+	for (int k = 0; k < kc; k++, a += 6, b += 32)
+	{
+		__m512 b0 = _mm512_load_ps(b), b1 = _mm512_load_ps(b + 16);
+		__m512 ar;
+
+		ar = _mm512_set1_ps(a[0]); c00 = _mm512_fmadd_ps(ar, b0, c00); c01 = _mm512_fmadd_ps(ar, b1, c01);
+		ar = _mm512_set1_ps(a[1]); c10 = _mm512_fmadd_ps(ar, b0, c10); c11 = _mm512_fmadd_ps(ar, b1, c11);
+		ar = _mm512_set1_ps(a[2]); c20 = _mm512_fmadd_ps(ar, b0, c20); c21 = _mm512_fmadd_ps(ar, b1, c21);
+		ar = _mm512_set1_ps(a[3]); c30 = _mm512_fmadd_ps(ar, b0, c30); c31 = _mm512_fmadd_ps(ar, b1, c31);
+		ar = _mm512_set1_ps(a[4]); c40 = _mm512_fmadd_ps(ar, b0, c40); c41 = _mm512_fmadd_ps(ar, b1, c41);
+		ar = _mm512_set1_ps(a[5]); c50 = _mm512_fmadd_ps(ar, b0, c50); c51 = _mm512_fmadd_ps(ar, b1, c51);
+	}
+
+	__m512 alphaVec = _mm512_set1_ps(alpha);
+	StoreRow_AVX512(c, c00, c01, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + ldc, c10, c11, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 2 * ldc, c20, c21, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 3 * ldc, c30, c31, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 4 * ldc, c40, c41, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 5 * ldc, c50, c51, alphaVec, beta, epilogue);
+}
+
+#endif
+
+static GemmConfig GetConfig()
+{
+	switch (VectorAccelator::GetLevel())
+	{
+#ifdef VA_X86
+	case SIMDLevel::AVX512:
+		return { 6, 32, 96, 256, 2048, &MicroKernel_AVX512 };
+	case SIMDLevel::AVX2:
+		return { 6, 16, 96, 256, 2048, &MicroKernel_AVX2 };
+	case SIMDLevel::SSE:
+		return { 4, 8, 96, 256, 2048, &MicroKernel_SSE };
+#endif
+	default:
+		return { 4, 4, 96, 256, 2048, &MicroKernel_Scalar };
+	}
+}
+
+// ---------- Packing ----------
+
+// Rows [row, row + mr) and columns [col, col + kc) of op(A), interleaved k-major, zero padded to MR rows
+static void PackPanelA(MatrixOp trans, const float* A, int lda, int row, int mr, int col, int kc, int MR, float* dst)
+{
+	if (trans == MatrixOp::NoTrans)
+	{
+		for (int r = 0; r < mr; r++)
+		{
+			const float* src = A + (size_t)(row + r) * lda + col;
+			for (int k = 0; k < kc; k++)
+				dst[k * MR + r] = src[k];
+		}
+	}
+	else
+	{
+		for (int k = 0; k < kc; k++)
+			memcpy(dst + k * MR, A + (size_t)(col + k) * lda + row, sizeof(float) * mr);
+	}
+
+	for (int r = mr; r < MR; r++)
+		for (int k = 0; k < kc; k++)
+			dst[k * MR + r] = 0.0f;
+}
+
+// Row-major operands as stored, read a contiguous segment of a row at a time
+struct FloatMatrix
+{
+	const float* data;
+	int ld;
+
+	const float* Segment(int row, int col, int count, float* scratch) const
+	{
+		return data + (size_t)row * ld + col;
+	}
+};
+
+// Half-precision weights are widened here, so the micro-kernels only ever see float panels
+struct HalfMatrix
+{
+	const unsigned short* data;
+	int ld;
+	HalfFormat format;
+
+	const float* Segment(int row, int col, int count, float* scratch) const
+	{
+		VectorAccelator::HalfToFloat(data + (size_t)row * ld + col, scratch, count, format);
+		return scratch;
+	}
+};
+
+// Longest segment PackPanelB reads at once, no smaller than any KC or NR
+static const int MaxSegment = 256;
+
+// Rows [row, row + kc) and columns [col, col + nr) of op(B), zero padded to NR columns
+template<typename Matrix>
+static void PackPanelB(MatrixOp trans, const Matrix& B, int row, int kc, int col, int nr, int NR, float* dst)
+{
+	alignas(64) float scratch[MaxSegment];
+
+	if (trans == MatrixOp::NoTrans)
+	{
+		for (int k = 0; k < kc; k++)
+		{
+			memcpy(dst + k * NR, B.Segment(row + k, col, nr, scratch), sizeof(float) * nr);
+			for (int j = nr; j < NR; j++)
+				dst[k * NR + j] = 0.0f;
+		}
+	}
+	else
+	{
+		for (int j = 0; j < nr; j++)
+		{
+			const float* src = B.Segment(col + j, row, kc, scratch);
+			for (int k = 0; k < kc; k++)
+				dst[k * NR + j] = src[k];
+		}
+
+		for (int k = 0; k < kc; k++)
+			for (int j = nr; j < NR; j++)
+				dst[k * NR + j] = 0.0f;
+	}
+}
+
+static void ScaleMatrix(int M, int N, float beta, float* C, int ldc)
+{
+	if (beta == 1.0f) return;
+
+	for (int i = 0; i < M; i++)
+	{
+		if (beta == 0.0f)
+			memset(C + (size_t)i * ldc, 0, sizeof(float) * N);
+		else
+			VectorAccelator::Scale(beta, C + (size_t)i * ldc, N);
+	}
+}
+
+template<typename Matrix>
+static void GemmImpl(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+	float alpha, const float* A, int lda, const Matrix& B,
+	float beta, float* C, int ldc, const MatrixEpilogue* epilogue)
+{
+	if (M <= 0 || N <= 0) return;
+
+	if (K <= 0 || alpha == 0.0f)
+	{
+		ScaleMatrix(M, N, beta, C, ldc);
+
+		if (epilogue)
+			for (int i = 0; i < M; i++)
+				ApplyEpilogue(*epilogue, C + (size_t)i * ldc, N);
+		return;
+	}
+
+	const GemmConfig config = GetConfig();
+	const int MR = config.MR, NR = config.NR;
+
+	const bool parallel = (long long)M * N * K >= ParallelThreshold && !omp_in_parallel() && !threadSerial;
+
+	const int panelsA = (M + MR - 1) / MR;
+	const int blocksM = (M + config.MC - 1) / config.MC;
+	const int panelsPerBlock = config.MC / MR;
+
+	float* packedA = packBufferA.Reserve((size_t)panelsA * MR * std::min(K, config.KC));
+	float* packedB = packBufferB.Reserve((size_t)(std::min(N, config.NC) + NR - 1) / NR * NR * std::min(K, config.KC));
+
+	for (int jc = 0; jc < N; jc += config.NC)
+	{
+		const int nc = std::min(config.NC, N - jc);
+		const int panelsB = (nc + NR - 1) / NR;
+
+		for (int pc = 0; pc < K; pc += config.KC)
+		{
+			const int kc = std::min(config.KC, K - pc);
+			const float betaBlock = pc == 0 ? beta : 1.0f; // later K blocks accumulate
+			const MatrixEpilogue* epilogueBlock = pc + kc == K ? epilogue : nullptr; // only once C is complete
+
+#pragma omp parallel if(parallel)
+			{
+#pragma omp for schedule(static)
+				for (int panel = 0; panel < panelsB; panel++)
+				{
+					int col = panel * NR;
+					PackPanelB(transB, B, pc, kc, jc + col, std::min(NR, nc - col), NR, packedB + (size_t)col * kc);
+				}
+
+#pragma omp for schedule(static)
+				for (int panel = 0; panel < panelsA; panel++)
+				{
+					int row = panel * MR;
+					PackPanelA(transA, A, lda, row, std::min(MR, M - row), pc, kc, MR, packedA + (size_t)row * kc);
+				}
+
+				// one task per (A block, B panel): the B panel stays in L1 while the A block streams from L2
+#pragma omp for collapse(2) schedule(static)
+				for (int blockM = 0; blockM < blocksM; blockM++)
+				{
+					for (int panelB = 0; panelB < panelsB; panelB++)
+					{
+						const int col = panelB * NR;
+						const int nr = std::min(NR, nc - col);
+						const float* b = packedB + (size_t)col * kc;
+
+						const int firstPanel = blockM * panelsPerBlock;
+						const int lastPanel = std::min(panelsA, firstPanel + panelsPerBlock);
+
+						for (int panelA = firstPanel; panelA < lastPanel; panelA++)
+						{
+							const int row = panelA * MR;
+							const int mr = std::min(MR, M - row);
+							const float* a = packedA + (size_t)row * kc;
+							float* c = C + (size_t)row * ldc + jc + col;
+
+							if (mr == MR && nr == NR)
+							{
+								config.kernel(kc, a, b, c, ldc, alpha, betaBlock, epilogueBlock);
+							}
+							else
+							{
+								// edge tile, computed aside and merged
+								alignas(64) float tile[MaxTileSize];
+								config.kernel(kc, a, b, tile, NR, 1.0f, 0.0f, nullptr);
+
+								for (int r = 0; r < mr; r++)
+								{
+									float* dst = c + (size_t)r * ldc;
+
+									for (int j = 0; j < nr; j++)
+										dst[j] = alpha * tile[r * NR + j] + (betaBlock == 0.0f ? 0.0f : betaBlock * dst[j]);
+
+									if (epilogueBlock) ApplyEpilogue(*epilogueBlock, dst, nr);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void MatrixAccelator::Gemm(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+	float alpha, const float* A, int lda, const float* B, int ldb,
+	float beta, float* C, int ldc, const MatrixEpilogue* epilogue)
+{
+	GemmImpl(transA, transB, M, N, K, alpha, A, lda, FloatMatrix{ B, ldb }, beta, C, ldc, epilogue);
+}
+
+void MatrixAccelator::Gemm(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+	float alpha, const float* A, int lda, const unsigned short* B, HalfFormat formatB, int ldb,
+	float beta, float* C, int ldc, const MatrixEpilogue* epilogue)
+{
+	GemmImpl(transA, transB, M, N, K, alpha, A, lda, HalfMatrix{ B, ldb, formatB }, beta, C, ldc, epilogue);
+}
+
+void MatrixAccelator::Gemv(MatrixOp trans, int rows, int cols, float alpha, const float* A, int lda, const float* x, float beta, float* y, const MatrixEpilogue* epilogue)
+{
+	const bool parallel = (long long)rows * cols >= ParallelThreshold && !omp_in_parallel() && !threadSerial;
+
+	if (trans == MatrixOp::NoTrans)
+	{
+		// y[i] = dot(A[i], x), 4 rows per pass share the loads of x
+		// rows are handed out in chunks, the epilogue runs on a chunk while it is still in L1
+		const int chunkSize = 64;
+		const int chunks = (rows + chunkSize - 1) / chunkSize;
+
+#pragma omp parallel for if(parallel) schedule(static)
+		for (int chunk = 0; chunk < chunks; chunk++)
+		{
+			int first = chunk * chunkSize;
+			int last = std::min(rows, first + chunkSize);
+
+			for (int row = first; row < last; row += 4)
+			{
+				int count = std::min(4, last - row);
+				float result[4];
+
+				if (count == 4)
+					VectorAccelator::Dot4(A + (size_t)row * lda, lda, x, cols, result);
+				else
+					for (int r = 0; r < count; r++)
+						result[r] = VectorAccelator::Dot(A + (size_t)(row + r) * lda, x, cols);
+
+				for (int r = 0; r < count; r++)
+					y[row + r] = alpha * result[r] + (beta == 0.0f ? 0.0f : beta * y[row + r]);
+			}
+
+			if (epilogue) ApplyEpilogue(*epilogue, y + first, last - first);
+		}
+	}
+	else
+	{
+		// y += x[i] * A[i], streams A row by row instead of walking its columns
+		// 4 rows are folded into y per pass, columns are split between threads
+		const int chunkSize = 256;
+		const int chunks = (cols + chunkSize - 1) / chunkSize;
+
+#pragma omp parallel for if(parallel) schedule(static)
+		for (int chunk = 0; chunk < chunks; chunk++)
+		{
+			int col = chunk * chunkSize;
+			int count = std::min(chunkSize, cols - col);
+
+			ScaleMatrix(1, count, beta, y + col, count);
+
+			int row = 0;
+			for (; row + 4 <= rows; row += 4)
+			{
+				float coeff[4] = { alpha * x[row], alpha * x[row + 1], alpha * x[row + 2], alpha * x[row + 3] };
+				VectorAccelator::Axpy4(coeff, A + (size_t)row * lda + col, lda, y + col, count);
+			}
+
+			for (; row < rows; row++)
+				VectorAccelator::Axpy(alpha * x[row], A + (size_t)row * lda + col, y + col, count);
+
+			if (epilogue) ApplyEpilogue(*epilogue, y + col, count);
+		}
+	}
+}
+
+void MatrixAccelator::Ger(int rows, int cols, float alpha, const float* x, const float* y, float* A, int lda)
+{
+	const bool parallel = (long long)rows * cols >= ParallelThreshold && !omp_in_parallel() && !threadSerial;
+
+#pragma omp parallel for if(parallel) schedule(static)
+	for (int row = 0; row < rows; row++)
+	{
+		if (x[row] != 0.0f)
+			VectorAccelator::Axpy(alpha * x[row], y, A + (size_t)row * lda, cols);
+	}
+}
+
+// ---------- Integer kernels ----------
+// Packed A holds groups of 4 columns: 16 rows x 4 bytes per group, so one 32-bit broadcast of X
+// multiplies 16 rows at once and no horizontal sums are needed
+// Each kernel computes one 16-row block for 4 samples, sharing the loads of A
+
+static const int BlockRowsU8S8 = 16;
+
+typedef void (*MicroKernelU8S8)(int groups, const signed char* a, const unsigned char* const* x, int* const* c);
+
+static void MicroKernelU8S8_Scalar(int groups, const signed char* a, const unsigned char* const* x, int* const* c)
+{
+	for (int s = 0; s < 4; s++)
+	{
+		int acc[BlockRowsU8S8] = {};
+
+		for (int g = 0; g < groups; g++)
+			for (int r = 0; r < BlockRowsU8S8; r++)
+				for (int k = 0; k < 4; k++)
+					acc[r] += (int)a[(g * BlockRowsU8S8 + r) * 4 + k] * (int)x[s][g * 4 + k];
+
+		memcpy(c[s], acc, sizeof(acc));
+	}
+}
+
+#ifdef VA_X86
+
+// u8 x s8 pairs summed to int16 by maddubs, then widened to int32 by madd against ones
+TARGET_AVX2 static void MicroKernelU8S8_AVX2(int groups, const signed char* a, const unsigned char* const* x, int* const* c)
+{
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+	__m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+	__m256i c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256();
+	__m256i c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256();
+
+	for (int g = 0; g < groups; g++, a += 64)
+	{
+		__m256i a0 = _mm256_load_si256((const __m256i*)a), a1 = _mm256_load_si256((const __m256i*)(a + 32));
+		__m256i xs;
+		int quad;
+
+		memcpy(&quad, x[0] + g * 4, 4); xs = _mm256_set1_epi32(quad);
+		c00 = _mm256_add_epi32(c00, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a0), ones));
+		c01 = _mm256_add_epi32(c01, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a1), ones));
+		memcpy(&quad, x[1] + g * 4, 4); xs = _mm256_set1_epi32(quad);
+		c10 = _mm256_add_epi32(c10, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a0), ones));
+		c11 = _mm256_add_epi32(c11, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a1), ones));
+		memcpy(&quad, x[2] + g * 4, 4); xs = _mm256_set1_epi32(quad);
+		c20 = _mm256_add_epi32(c20, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a0), ones));
+		c21 = _mm256_add_epi32(c21, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a1), ones));
+		memcpy(&quad, x[3] + g * 4, 4); xs = _mm256_set1_epi32(quad);
+		c30 = _mm256_add_epi32(c30, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a0), ones));
+		c31 = _mm256_add_epi32(c31, _mm256_madd_epi16(_mm256_maddubs_epi16(xs, a1), ones));
+	}
+
+	_mm256_storeu_si256((__m256i*)c[0], c00); _mm256_storeu_si256((__m256i*)(c[0] + 8), c01);
+	_mm256_storeu_si256((__m256i*)c[1], c10); _mm256_storeu_si256((__m256i*)(c[1] + 8), c11);
+	_mm256_storeu_si256((__m256i*)c[2], c20); _mm256_storeu_si256((__m256i*)(c[2] + 8), c21);
+	_mm256_storeu_si256((__m256i*)c[3], c30); _mm256_storeu_si256((__m256i*)(c[3] + 8), c31);
+}
+
+// vpdpbusd multiplies u8 x s8 quadruples and accumulates into int32 in one instruction
+TARGET_AVX512VNNI static void MicroKernelU8S8_AVX512VNNI(int groups, const signed char* a, const unsigned char* const* x, int* const* c)
+{
+	__m512i c0 = _mm512_setzero_si512(), c1 = _mm512_setzero_si512();
+	__m512i c2 = _mm512_setzero_si512(), c3 = _mm512_setzero_si512();
+
+	for (int g = 0; g < groups; g++, a += 64)
+	{
+		__m512i av = _mm512_load_si512(a);
+		int quad;
+
+		memcpy(&quad, x[0] + g * 4, 4); c0 = _mm512_dpbusd_epi32(c0, _mm512_set1_epi32(quad), av);
+		memcpy(&quad, x[1] + g * 4, 4); c1 = _mm512_dpbusd_epi32(c1, _mm512_set1_epi32(quad), av);
+		memcpy(&quad, x[2] + g * 4, 4); c2 = _mm512_dpbusd_epi32(c2, _mm512_set1_epi32(quad), av);
+		memcpy(&quad, x[3] + g * 4, 4); c3 = _mm512_dpbusd_epi32(c3, _mm512_set1_epi32(quad), av);
+	}
+
+	_mm512_storeu_si512(c[0], c0);
+	_mm512_storeu_si512(c[1], c1);
+	_mm512_storeu_si512(c[2], c2);
+	_mm512_storeu_si512(c[3], c3);
+}
+
+#endif
+
+static MicroKernelU8S8 GetKernelU8S8()
+{
+	switch (VectorAccelator::GetLevel())
+	{
+#ifdef VA_X86
+	case SIMDLevel::AVX512:
+		return VectorAccelator::HasVNNI() ? &MicroKernelU8S8_AVX512VNNI : &MicroKernelU8S8_AVX2;
+	case SIMDLevel::AVX2:
+		return &MicroKernelU8S8_AVX2;
+#endif
+	default:
+		return &MicroKernelU8S8_Scalar;
+	}
+}
+
+size_t MatrixAccelator::PackedSizeU8S8(int rows, int cols)
+{
+	return (size_t)(rows + BlockRowsU8S8 - 1) / BlockRowsU8S8 * BlockRowsU8S8 * ((cols + 3) / 4 * 4);
+}
+
+void MatrixAccelator::PackU8S8(int rows, int cols, const signed char* A, int lda, signed char* packed)
+{
+	const int blocks = (rows + BlockRowsU8S8 - 1) / BlockRowsU8S8;
+	const int groups = (cols + 3) / 4;
+
+	for (int block = 0; block < blocks; block++)
+		for (int g = 0; g < groups; g++)
+			for (int r = 0; r < BlockRowsU8S8; r++)
+				for (int k = 0; k < 4; k++)
+				{
+					int row = block * BlockRowsU8S8 + r, col = g * 4 + k;
+					*packed++ = row < rows && col < cols ? A[(size_t)row * lda + col] : 0;
+				}
+}
+
+void MatrixAccelator::GemmU8S8(int count, int rows, int cols, const unsigned char* X, int ldx, const signed char* packed, int* C, int ldc)
+{
+	const MicroKernelU8S8 kernel = GetKernelU8S8();
+	const int blocks = (rows + BlockRowsU8S8 - 1) / BlockRowsU8S8;
+	const int groups = (cols + 3) / 4;
+	const int sampleGroups = (count + 3) / 4;
+
+	const bool parallel = (long long)count * rows * cols >= ParallelThreshold && !omp_in_parallel() && !threadSerial;
+
+#pragma omp parallel for if(parallel) schedule(static)
+	for (int sampleGroup = 0; sampleGroup < sampleGroups; sampleGroup++)
+	{
+		// missing samples of the last group repeat the first one into a scratch row
+		alignas(64) int scratch[BlockRowsU8S8];
+		const unsigned char* x[4];
+		int first = sampleGroup * 4;
+
+		for (int s = 0; s < 4; s++)
+			x[s] = X + (size_t)(first + (first + s < count ? s : 0)) * ldx;
+
+		for (int block = 0; block < blocks; block++)
+		{
+			int* c[4];
+			for (int s = 0; s < 4; s++)
+				c[s] = first + s < count ? C + (size_t)(first + s) * ldc + block * BlockRowsU8S8 : scratch;
+
+			kernel(groups, packed + (size_t)block * BlockRowsU8S8 * groups * 4, x, c);
+		}
+	}
+}
+
+// ---------- BF16 products ----------
+// Panels hold two consecutive k of a row or column in one 32-bit word, the lower k in the low half,
+// so vdpbf16ps multiplies both pairs and adds them to a float accumulator in one instruction
+// A is rounded to BF16 while packed, B is BF16 as stored
+
+#ifdef VA_X86
+
+static const int MRBF16 = 6, NRBF16 = 32;
+static const int MCBF16 = 96, KCBF16 = 256, NCBF16 = 2048;
+
+typedef unsigned int PairBF16;
+
+// Rows [row, row + mr) and columns [col, col + kc) of op(A), pairs interleaved k-major, zero padded to MRBF16 rows and an even kc
+static void PackPanelABF16(MatrixOp trans, const float* A, int lda, int row, int mr, int col, int kc, PairBF16* dst)
+{
+	alignas(64) float gathered[KCBF16];
+	alignas(64) unsigned short rounded[KCBF16 + 1];
+	const int pairs = (kc + 1) / 2;
+
+	for (int r = 0; r < mr; r++)
+	{
+		const float* src = A + (size_t)(row + r) * lda + col;
+
+		if (trans == MatrixOp::Trans)
+		{
+			for (int k = 0; k < kc; k++)
+				gathered[k] = A[(size_t)(col + k) * lda + row + r];
+			src = gathered;
+		}
+
+		VectorAccelator::FloatToHalf(src, rounded, kc, HalfFormat::BF16);
+		rounded[kc] = 0;
+
+		for (int p = 0; p < pairs; p++)
+			dst[p * MRBF16 + r] = rounded[2 * p] | (PairBF16)rounded[2 * p + 1] << 16;
+	}
+
+	for (int r = mr; r < MRBF16; r++)
+		for (int p = 0; p < pairs; p++)
+			dst[p * MRBF16 + r] = 0;
+}
+
+// Rows [row, row + kc) and columns [col, col + nr) of op(B), pairs interleaved k-major, zero padded to NRBF16 columns and an even kc
+TARGET_AVX512BF16 static void PackPanelBBF16(MatrixOp trans, const unsigned short* B, int ldb, int row, int kc, int col, int nr, PairBF16* dst)
+{
+	const int pairs = (kc + 1) / 2;
+
+	if (trans == MatrixOp::NoTrans)
+	{
+		// word i of the low half takes column i / 2 of the even row (i even) or the odd row (i odd)
+		const __m512i low = _mm512_set_epi16(47, 15, 46, 14, 45, 13, 44, 12, 43, 11, 42, 10, 41, 9, 40, 8, 39, 7, 38, 6, 37, 5, 36, 4, 35, 3, 34, 2, 33, 1, 32, 0);
+		const __m512i high = _mm512_add_epi16(low, _mm512_set1_epi16(16));
+
+		for (int p = 0; p < pairs; p++)
+		{
+			const unsigned short* even = B + (size_t)(row + 2 * p) * ldb + col;
+			const unsigned short* odd = 2 * p + 1 < kc ? even + ldb : nullptr;
+			PairBF16* out = dst + p * NRBF16;
+
+			if (nr == NRBF16 && odd)
+			{
+				__m512i e = _mm512_loadu_si512(even), o = _mm512_loadu_si512(odd);
+				_mm512_store_si512(out, _mm512_permutex2var_epi16(e, low, o));
+				_mm512_store_si512(out + 16, _mm512_permutex2var_epi16(e, high, o));
+				continue;
+			}
+
+			for (int j = 0; j < nr; j++)
+				out[j] = even[j] | (odd ? (PairBF16)odd[j] << 16 : 0);
+			for (int j = nr; j < NRBF16; j++)
+				out[j] = 0;
+		}
+	}
+	else
+	{
+		// a row of B as stored is a column of op(B), its pairs are already adjacent
+		for (int j = 0; j < nr; j++)
+		{
+			const unsigned short* src = B + (size_t)(col + j) * ldb + row;
+
+			for (int p = 0; p < kc / 2; p++)
+				dst[p * NRBF16 + j] = src[2 * p] | (PairBF16)src[2 * p + 1] << 16;
+			if (kc % 2)
+				dst[(pairs - 1) * NRBF16 + j] = src[kc - 1];
+		}
+
+		for (int p = 0; p < pairs; p++)
+			for (int j = nr; j < NRBF16; j++)
+				dst[p * NRBF16 + j] = 0;
+	}
+}
+
+TARGET_AVX512BF16 static inline __m512bh AsBF16(__m512i v)
+{
+	return (__m512bh)v;
+}
+
+// 6 x 32 tile, 12 accumulators, two k per step
+TARGET_AVX512BF16 static void MicroKernelBF16_AVX512(int pairs, const PairBF16* a, const PairBF16* b, float* c, int ldc, float alpha, float beta, const MatrixEpilogue* epilogue)
+{
+	__m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+	__m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+	__m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+	__m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+	__m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+	__m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+
+	for (int p = 0; p < pairs; p++, a += 6, b += 32)
+	{
+		__m512bh b0 = AsBF16(_mm512_load_si512(b)), b1 = AsBF16(_mm512_load_si512(b + 16));
+		__m512bh ar;
+
+		ar = AsBF16(_mm512_set1_epi32(a[0])); c00 = _mm512_dpbf16_ps(c00, ar, b0); c01 = _mm512_dpbf16_ps(c01, ar, b1);
+		ar = AsBF16(_mm512_set1_epi32(a[1])); c10 = _mm512_dpbf16_ps(c10, ar, b0); c11 = _mm512_dpbf16_ps(c11, ar, b1);
+		ar = AsBF16(_mm512_set1_epi32(a[2])); c20 = _mm512_dpbf16_ps(c20, ar, b0); c21 = _mm512_dpbf16_ps(c21, ar, b1);
+		ar = AsBF16(_mm512_set1_epi32(a[3])); c30 = _mm512_dpbf16_ps(c30, ar, b0); c31 = _mm512_dpbf16_ps(c31, ar, b1);
+		ar = AsBF16(_mm512_set1_epi32(a[4])); c40 = _mm512_dpbf16_ps(c40, ar, b0); c41 = _mm512_dpbf16_ps(c41, ar, b1);
+		ar = AsBF16(_mm512_set1_epi32(a[5])); c50 = _mm512_dpbf16_ps(c50, ar, b0); c51 = _mm512_dpbf16_ps(c51, ar, b1);
+	}
+
+	__m512 alphaVec = _mm512_set1_ps(alpha);
+	StoreRow_AVX512(c, c00, c01, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + ldc, c10, c11, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 2 * ldc, c20, c21, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 3 * ldc, c30, c31, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 4 * ldc, c40, c41, alphaVec, beta, epilogue);
+	StoreRow_AVX512(c + 5 * ldc, c50, c51, alphaVec, beta, epilogue);
+}
+
+// Same blocking as GemmImpl, on pair panels
+static void GemmImplBF16(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+	float alpha, const float* A, int lda, const unsigned short* B, int ldb,
+	float beta, float* C, int ldc, const MatrixEpilogue* epilogue)
+{
+	const bool parallel = (long long)M * N * K >= ParallelThreshold && !omp_in_parallel() && !threadSerial;
+
+	const int panelsA = (M + MRBF16 - 1) / MRBF16;
+	const int blocksM = (M + MCBF16 - 1) / MCBF16;
+	const int panelsPerBlock = MCBF16 / MRBF16;
+	const int maxPairs = (std::min(K, KCBF16) + 1) / 2;
+
+	// pairs take the room of one float each
+	PairBF16* packedA = (PairBF16*)packBufferA.Reserve((size_t)panelsA * MRBF16 * maxPairs);
+	PairBF16* packedB = (PairBF16*)packBufferB.Reserve((size_t)(std::min(N, NCBF16) + NRBF16 - 1) / NRBF16 * NRBF16 * maxPairs);
+
+	for (int jc = 0; jc < N; jc += NCBF16)
+	{
+		const int nc = std::min(NCBF16, N - jc);
+		const int panelsB = (nc + NRBF16 - 1) / NRBF16;
+
+		for (int pc = 0; pc < K; pc += KCBF16)
+		{
+			const int kc = std::min(KCBF16, K - pc);
+			const int pairs = (kc + 1) / 2;
+			const float betaBlock = pc == 0 ? beta : 1.0f;
+			const MatrixEpilogue* epilogueBlock = pc + kc == K ? epilogue : nullptr;
+
+#pragma omp parallel if(parallel)
+			{
+#pragma omp for schedule(static)
+				for (int panel = 0; panel < panelsB; panel++)
+				{
+					int col = panel * NRBF16;
+					PackPanelBBF16(transB, B, ldb, pc, kc, jc + col, std::min(NRBF16, nc - col), packedB + (size_t)col * pairs);
+				}
+
+#pragma omp for schedule(static)
+				for (int panel = 0; panel < panelsA; panel++)
+				{
+					int row = panel * MRBF16;
+					PackPanelABF16(transA, A, lda, row, std::min(MRBF16, M - row), pc, kc, packedA + (size_t)row * pairs);
+				}
+
+#pragma omp for collapse(2) schedule(static)
+				for (int blockM = 0; blockM < blocksM; blockM++)
+				{
+					for (int panelB = 0; panelB < panelsB; panelB++)
+					{
+						const int col = panelB * NRBF16;
+						const int nr = std::min(NRBF16, nc - col);
+						const PairBF16* b = packedB + (size_t)col * pairs;
+
+						const int firstPanel = blockM * panelsPerBlock;
+						const int lastPanel = std::min(panelsA, firstPanel + panelsPerBlock);
+
+						for (int panelA = firstPanel; panelA < lastPanel; panelA++)
+						{
+							const int row = panelA * MRBF16;
+							const int mr = std::min(MRBF16, M - row);
+							const PairBF16* a = packedA + (size_t)row * pairs;
+							float* c = C + (size_t)row * ldc + jc + col;
+
+							if (mr == MRBF16 && nr == NRBF16)
+							{
+								MicroKernelBF16_AVX512(pairs, a, b, c, ldc, alpha, betaBlock, epilogueBlock);
+							}
+							else
+							{
+								alignas(64) float tile[MaxTileSize];
+								MicroKernelBF16_AVX512(pairs, a, b, tile, NRBF16, 1.0f, 0.0f, nullptr);
+
+								for (int r = 0; r < mr; r++)
+								{
+									float* dst = c + (size_t)r * ldc;
+
+									for (int j = 0; j < nr; j++)
+										dst[j] = alpha * tile[r * NRBF16 + j] + (betaBlock == 0.0f ? 0.0f : betaBlock * dst[j]);
+
+									if (epilogueBlock) ApplyEpilogue(*epilogueBlock, dst, nr);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+#endif
+
+void MatrixAccelator::GemmBF16(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+	float alpha, const float* A, int lda, const unsigned short* B, int ldb,
+	float beta, float* C, int ldc, const MatrixEpilogue* epilogue)
+{
+#ifdef VA_X86
+	if (M > 0 && N > 0 && K > 0 && alpha != 0.0f && VectorAccelator::GetLevel() == SIMDLevel::AVX512 && VectorAccelator::HasBF16())
+	{
+		GemmImplBF16(transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc, epilogue);
+		return;
+	}
+#endif
+
+	GemmImpl(transA, transB, M, N, K, alpha, A, lda, HalfMatrix{ B, ldb, HalfFormat::BF16 }, beta, C, ldc, epilogue);
+}
+
+bool MatrixAccelator::SetThreadSerial(bool serial)
+{
+	bool previous = threadSerial;
+	threadSerial = serial;
+	return previous;
+}
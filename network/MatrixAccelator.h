@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+
+#include "VectorAccelator.h"
+
+enum class MatrixOp : int
+{
+	NoTrans, Trans
+};
+
+// Elementwise activations an epilogue can apply to a product
+enum class EpilogueActivation : int
+{
+	Linear, ReLU, LeakyReLU, Sigmoid, SigmoidShifted
+};
+
+// out = activation(scale * product + shift), applied while the product is written out
+struct MatrixEpilogue
+{
+	float scale = 1.0f;
+	float shift = 0.0f;
+	EpilogueActivation activation = EpilogueActivation::Linear;
+	float slope = 0.0f; // negative slope of LeakyReLU, within [0, 1]
+};
+
+// Dense matrix products on row-major float matrices, built on the VectorAccelator instruction set
+// GEMM packs panels of both operands, blocks them for cache and runs a register-tiled micro-kernel
+class MatrixAccelator
+{
+public:
+	/// <summary>
+	/// C = alpha * op(A) * op(B) + beta * C, then the epilogue (if any) on every element of C
+	/// </summary>
+	/// <param name="M">Rows of op(A) and C</param>
+	/// <param name="N">Columns of op(B) and C</param>
+	/// <param name="K">Columns of op(A), rows of op(B)</param>
+	/// <param name="lda">Leading dimension (row stride) of A as stored</param>
+	static void Gemm(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+		float alpha, const float* A, int lda, const float* B, int ldb,
+		float beta, float* C, int ldc, const MatrixEpilogue* epilogue = nullptr);
+
+	/// <summary>
+	/// Gemm with B stored as 16-bit floats, widened while packed, accumulated in float
+	/// </summary>
+	static void Gemm(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+		float alpha, const float* A, int lda, const unsigned short* B, HalfFormat formatB, int ldb,
+		float beta, float* C, int ldc, const MatrixEpilogue* epilogue = nullptr);
+
+	/// <summary>
+	/// Mixed-precision Gemm, B stored as BF16 and A rounded to BF16 while packed, products accumulated in float
+	/// Runs on vdpbf16ps where the CPU has AVX512-BF16, elsewhere it is the 16-bit Gemm above and A stays float
+	/// </summary>
+	static void GemmBF16(MatrixOp transA, MatrixOp transB, int M, int N, int K,
+		float alpha, const float* A, int lda, const unsigned short* B, int ldb,
+		float beta, float* C, int ldc, const MatrixEpilogue* epilogue = nullptr);
+
+	/// <summary>
+	/// y = alpha * op(A) * x + beta * y, A is a rows x cols matrix, then the epilogue (if any) on every element of y
+	/// </summary>
+	static void Gemv(MatrixOp trans, int rows, int cols, float alpha, const float* A, int lda, const float* x, float beta, float* y, const MatrixEpilogue* epilogue = nullptr);
+
+	/// <summary>
+	/// A += alpha * x * y^T, A is a rows x cols matrix
+	/// </summary>
+	static void Ger(int rows, int cols, float alpha, const float* x, const float* y, float* A, int lda);
+
+	/// <summary>
+	/// Bytes taken by a rows x cols int8 matrix packed for GemmU8S8
+	/// </summary>
+	static size_t PackedSizeU8S8(int rows, int cols);
+
+	/// <summary>
+	/// Pack an int8 matrix in blocks of 16 rows, 4 consecutive columns of a row kept together, zero padded
+	/// </summary>
+	static void PackU8S8(int rows, int cols, const signed char* A, int lda, signed char* packed);
+
+	/// <summary>
+	/// C = X * A^T on integers, X is a count x cols uint8 matrix, A a rows x cols packed int8 matrix
+	/// </summary>
+	/// <param name="X">Values must stay within [0, 127], rows are read up to cols rounded up to 4</param>
+	/// <param name="C">int32, rows are written up to rows rounded up to 16</param>
+	static void GemmU8S8(int count, int rows, int cols, const unsigned char* X, int ldx, const signed char* packed, int* C, int ldc);
+
+	/// <summary>
+	/// Keep every product called from this thread on this thread, for threads of a pool other than OpenMP
+	/// </summary>
+	/// <returns>Previous setting</returns>
+	static bool SetThreadSerial(bool serial);
+};
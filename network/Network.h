@@ -6,5 +6,12 @@
 #include "NetworkData.h"
 #include "NetworkFramework.h"
 #include "NetworkDataParser.h"
+#include "QuantizedNetwork.h"
+#include "HalfNetwork.h"
+#include "NetworkEvaluator.h"
+#include "CheckpointWriter.h"
+#include "Deterministic.h"
+#include "RingAllReduce.h"
+#include "BatchLoader.h"
 
 #endif
\ No newline at end of file
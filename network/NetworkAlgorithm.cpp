@@ -1,4 +1,5 @@
 #include "NetworkAlgorithm.h"
+#include "VectorAccelator.h"
 
 #include<math.h>
 
@@ -57,6 +58,205 @@ float_n Network::Algorithm::Linear_D(float_n x)
 	return 1;
 }
 
+// Activation functions as types, so the vector loops below are specialized and inlined per function
+template<Network::ActivateFunctionType type> struct Activation;
+
+template<> struct Activation<Network::ActivateFunctionType::Sigmoid>
+{
+	static inline float_n Forward(float_n x) { return 1.0f / (1.0f + expf(-x)); }
+	static inline float_n Backward(float_n y) { return y * (1.0f - y); }
+};
+
+template<> struct Activation<Network::ActivateFunctionType::SigmoidShifted>
+{
+	static inline float_n Forward(float_n x) { return 2.0f / (1.0f + expf(-x)) - 1.0f; }
+	static inline float_n Backward(float_n y) { return (y + 1.0f) * (1.0f - y) * 0.25f; }
+};
+
+template<> struct Activation<Network::ActivateFunctionType::ReLU>
+{
+	static inline float_n Forward(float_n x) { return x > 0.0f ? x : 0.0f; }
+	static inline float_n Backward(float_n y) { return y > 0.0f ? 1.0f : 0.0f; }
+};
+
+template<> struct Activation<Network::ActivateFunctionType::LeakyReLU>
+{
+	static inline float_n Forward(float_n x) { return x > 0.0f ? x : x * (float_n)LEAKY_RELU_CONST; }
+	static inline float_n Backward(float_n y) { return y > 0.0f ? 1.0f : (float_n)LEAKY_RELU_CONST; }
+};
+
+template<> struct Activation<Network::ActivateFunctionType::Linear>
+{
+	static inline float_n Forward(float_n x) { return x; }
+	static inline float_n Backward(float_n y) { return 1.0f; }
+};
+
+template<Network::ActivateFunctionType type>
+static void ActivateVectorT(float_n* data, int count, float_n scale, float_n shift)
+{
+	for (int i = 0; i < count; i++)
+		data[i] = Activation<type>::Forward(data[i] * scale + shift);
+}
+
+// exp() doesn't auto-vectorize on every compiler, sigmoids go through the SIMD kernel
+template<>
+void ActivateVectorT<Network::ActivateFunctionType::Sigmoid>(float_n* data, int count, float_n scale, float_n shift)
+{
+	for (int i = 0; i < count; i++)
+		data[i] = data[i] * scale + shift;
+
+	VectorAccelator::Sigmoid(data, count);
+}
+
+template<>
+void ActivateVectorT<Network::ActivateFunctionType::SigmoidShifted>(float_n* data, int count, float_n scale, float_n shift)
+{
+	ActivateVectorT<Network::ActivateFunctionType::Sigmoid>(data, count, scale, shift);
+
+	for (int i = 0; i < count; i++)
+		data[i] = data[i] * 2.0f - 1.0f;
+}
+
+template<Network::ActivateFunctionType type>
+static float_n BiasDirectionT(const float_n* error, int count, float_n bias)
+{
+	float_n sum = 0.0;
+	for (int i = 0; i < count; i++)
+		sum += error[i];
+
+	return Activation<type>::Backward(bias) * sum;
+}
+
+template<Network::ActivateFunctionType type>
+static void WeightUpdateCoefficientsT(const float_n* value, const float_n* error, int count, float_n learningRate, float_n* coeff, float_n& bias)
+{
+	for (int i = 0; i < count; i++)
+		coeff[i] = learningRate * Activation<type>::Backward(value[i]) * error[i];
+
+	// bias depends on its previous value, kept out of the vector loop
+	for (int i = 0; i < count; i++)
+		bias += learningRate * Activation<type>::Backward(bias) * error[i];
+}
+
+template<Network::ActivateFunctionType type>
+static void LayerDeltaT(const float_n* value, const float_n* error, int count, float_n* delta)
+{
+	for (int i = 0; i < count; i++)
+		delta[i] = Activation<type>::Backward(value[i]) * error[i];
+}
+
+void Network::Algorithm::ActivateVector(ActivateFunctionType type, float_n* data, int count, float_n scale, float_n shift)
+{
+	switch (type)
+	{
+	case ActivateFunctionType::Sigmoid:
+		ActivateVectorT<ActivateFunctionType::Sigmoid>(data, count, scale, shift);
+		break;
+	case ActivateFunctionType::SigmoidShifted:
+		ActivateVectorT<ActivateFunctionType::SigmoidShifted>(data, count, scale, shift);
+		break;
+	case ActivateFunctionType::ReLU:
+		ActivateVectorT<ActivateFunctionType::ReLU>(data, count, scale, shift);
+		break;
+	case ActivateFunctionType::LeakyReLU:
+		ActivateVectorT<ActivateFunctionType::LeakyReLU>(data, count, scale, shift);
+		break;
+	default:
+		ActivateVectorT<ActivateFunctionType::Linear>(data, count, scale, shift);
+		break;
+	}
+}
+
+MatrixEpilogue Network::Algorithm::LayerEpilogue(ActivateFunctionType type, float_n scale, float_n shift)
+{
+	MatrixEpilogue epilogue;
+	epilogue.scale = scale;
+	epilogue.shift = shift;
+
+	switch (type)
+	{
+	case ActivateFunctionType::Sigmoid:
+		epilogue.activation = EpilogueActivation::Sigmoid;
+		break;
+	case ActivateFunctionType::SigmoidShifted:
+		epilogue.activation = EpilogueActivation::SigmoidShifted;
+		break;
+	case ActivateFunctionType::ReLU:
+		epilogue.activation = EpilogueActivation::ReLU;
+		break;
+	case ActivateFunctionType::LeakyReLU:
+		epilogue.activation = EpilogueActivation::LeakyReLU;
+		epilogue.slope = (float_n)LEAKY_RELU_CONST;
+		break;
+	default:
+		epilogue.activation = EpilogueActivation::Linear;
+		break;
+	}
+
+	return epilogue;
+}
+
+void Network::Algorithm::WeightUpdateCoefficients(ActivateFunctionType type, const float_n* value, const float_n* error, int count, float_n learningRate, float_n* coeff, float_n& bias)
+{
+	switch (type)
+	{
+	case ActivateFunctionType::Sigmoid:
+		WeightUpdateCoefficientsT<ActivateFunctionType::Sigmoid>(value, error, count, learningRate, coeff, bias);
+		break;
+	case ActivateFunctionType::SigmoidShifted:
+		WeightUpdateCoefficientsT<ActivateFunctionType::SigmoidShifted>(value, error, count, learningRate, coeff, bias);
+		break;
+	case ActivateFunctionType::ReLU:
+		WeightUpdateCoefficientsT<ActivateFunctionType::ReLU>(value, error, count, learningRate, coeff, bias);
+		break;
+	case ActivateFunctionType::LeakyReLU:
+		WeightUpdateCoefficientsT<ActivateFunctionType::LeakyReLU>(value, error, count, learningRate, coeff, bias);
+		break;
+	default:
+		WeightUpdateCoefficientsT<ActivateFunctionType::Linear>(value, error, count, learningRate, coeff, bias);
+		break;
+	}
+}
+
+void Network::Algorithm::LayerDelta(ActivateFunctionType type, const float_n* value, const float_n* error, int count, float_n* delta)
+{
+	switch (type)
+	{
+	case ActivateFunctionType::Sigmoid:
+		LayerDeltaT<ActivateFunctionType::Sigmoid>(value, error, count, delta);
+		break;
+	case ActivateFunctionType::SigmoidShifted:
+		LayerDeltaT<ActivateFunctionType::SigmoidShifted>(value, error, count, delta);
+		break;
+	case ActivateFunctionType::ReLU:
+		LayerDeltaT<ActivateFunctionType::ReLU>(value, error, count, delta);
+		break;
+	case ActivateFunctionType::LeakyReLU:
+		LayerDeltaT<ActivateFunctionType::LeakyReLU>(value, error, count, delta);
+		break;
+	default:
+		LayerDeltaT<ActivateFunctionType::Linear>(value, error, count, delta);
+		break;
+	}
+}
+
+float_n Network::Algorithm::BiasDirection(ActivateFunctionType type, const float_n* error, int count, float_n bias)
+{
+	switch (type)
+	{
+	case ActivateFunctionType::Sigmoid:
+		return BiasDirectionT<ActivateFunctionType::Sigmoid>(error, count, bias);
+	case ActivateFunctionType::SigmoidShifted:
+		return BiasDirectionT<ActivateFunctionType::SigmoidShifted>(error, count, bias);
+	case ActivateFunctionType::ReLU:
+		return BiasDirectionT<ActivateFunctionType::ReLU>(error, count, bias);
+	case ActivateFunctionType::LeakyReLU:
+		return BiasDirectionT<ActivateFunctionType::LeakyReLU>(error, count, bias);
+	default:
+		return BiasDirectionT<ActivateFunctionType::Linear>(error, count, bias);
+	}
+}
+
 // NOTE: Added offset (2023-2-20)
 void Normalization_ZeroToOne(float* dataOut, int offset, unsigned char* data, int dataSize)
 {
@@ -154,6 +354,36 @@ void Network::Algorithm::SoftMax(Network::NeuronLayerInstance& layer)
 	}
 }
 
+void Network::Algorithm::SoftMax(Network::NeuronLayerBatch& layer, int count)
+{
+	for (int sample = 0; sample < count; sample++)
+	{
+		float_n* value = layer.Sample(sample);
+
+		float_n sum = 0.0;
+		float_n biggestValue = value[0];
+
+		// find largest value in neurons
+		for (int i = 0; i < layer.neuronCount; i++)
+		{
+			if (value[i] > biggestValue)
+				biggestValue = value[i];
+		}
+
+		// add up sums
+		for (int i = 0; i < layer.neuronCount; i++)
+		{
+			sum += exp(value[i] - biggestValue);
+		}
+
+		// set values
+		for (int i = 0; i < layer.neuronCount; i++)
+		{
+			value[i] = exp(value[i] - biggestValue) / sum;
+		}
+	}
+}
+
 void Network::Algorithm::SoftMaxGetError(NeuronLayer& layer, float_n* target)
 {
 	for (int i = 0; i < layer.neuronCount; i++)
@@ -168,4 +398,19 @@ void Network::Algorithm::SoftMaxGetError(NeuronLayerInstance& layer, float_n* ta
 	{
 		layer.error[i] = target[i] - layer.value[i];
 	}
+}
+
+void Network::Algorithm::SoftMaxGetError(NeuronLayerBatch& layer, float_n* target, int count)
+{
+	for (int sample = 0; sample < count; sample++)
+	{
+		float_n* value = layer.Sample(sample);
+		float_n* error = layer.SampleError(sample);
+		float_n* sampleTarget = target + (size_t)sample * layer.valueStride;
+
+		for (int i = 0; i < layer.neuronCount; i++)
+		{
+			error[i] = sampleTarget[i] - value[i];
+		}
+	}
 }
\ No newline at end of file
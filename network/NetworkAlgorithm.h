@@ -2,11 +2,17 @@
 #define _NETWORK_ALGORITHM_H_
 
 #include "NetworkStructure.h"
+#include "MatrixAccelator.h"
 
 namespace Network
 {
 	typedef float_n(*ActivateFunction)(float_n);
 
+	enum class ActivateFunctionType :int
+	{
+		Sigmoid, SigmoidShifted, ReLU, LeakyReLU, Linear
+	};
+
 	namespace Algorithm
 	{
 		enum NormalizationMode
@@ -69,11 +75,37 @@ namespace Network
 		/// <returns>Processed Data Pointer</returns>
 		float* NormalizeData(unsigned char* data, int offset, int dataSize, NormalizationMode mode);
 
+		/// <summary>
+		/// data[i] = f(data[i] * scale + shift) over a whole vector, specialized per activation function
+		/// </summary>
+		void ActivateVector(ActivateFunctionType type, float_n* data, int count, float_n scale, float_n shift);
+
+		/// <summary>
+		/// Epilogue computing f(x * scale + shift) as a layer product is written out
+		/// </summary>
+		MatrixEpilogue LayerEpilogue(ActivateFunctionType type, float_n scale, float_n shift);
+
+		/// <summary>
+		/// Coefficients of a weight update: coeff[i] = learningRate * f'(value[i]) * error[i], bias tweaked alike
+		/// </summary>
+		void WeightUpdateCoefficients(ActivateFunctionType type, const float_n* value, const float_n* error, int count, float_n learningRate, float_n* coeff, float_n& bias);
+
+		/// <summary>
+		/// Error terms of a layer's products: delta[i] = f'(value[i]) * error[i], delta may be error itself
+		/// </summary>
+		void LayerDelta(ActivateFunctionType type, const float_n* value, const float_n* error, int count, float_n* delta);
+
+		/// <summary>
+		/// Direction the bias tweak of WeightUpdateCoefficients moves the bias in, with the derivative held at the current bias
+		/// </summary>
+		float_n BiasDirection(ActivateFunctionType type, const float_n* error, int count, float_n bias);
+
 		/// <summary>
 		/// Softmax
 		/// </summary>
 		void SoftMax(NeuronLayer& layer);
 		void SoftMax(NeuronLayerInstance& layer);
+		void SoftMax(NeuronLayerBatch& layer, int count);
 
 		/// <summary>
 		/// Softmax
@@ -81,13 +113,9 @@ namespace Network
 		/// <param name="target">Target Data used for error calculation</param>
 		void SoftMaxGetError(NeuronLayer& layer, float_n* target);
 		void SoftMaxGetError(NeuronLayerInstance& layer, float_n* target);
+		void SoftMaxGetError(NeuronLayerBatch& layer, float_n* target, int count);
 	}
 
-	enum class ActivateFunctionType :int
-	{
-		Sigmoid, SigmoidShifted, ReLU, LeakyReLU, Linear
-	};
-
 	const int ActivateFunctionCount = 4;
 
 	inline const Network::ActivateFunction forwardFuncList[] =
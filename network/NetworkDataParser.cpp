@@ -3,6 +3,7 @@
 #include "FileHelper.h"
 
 #include <format>
+#include <string.h>
 #include "../jsoncpp/json.h"
 
 using namespace Network;
@@ -160,7 +161,60 @@ ProcessState NetworkDataParser::ReadMNISTData(NetworkDataSet* dataSet, std::stri
 	return ProcessState(true);
 }
 
-Json::Value SaveLayerJSON(NeuronLayer* layer)
+static const char* Base64Alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string EncodeBase64(const unsigned char* data, size_t size)
+{
+	std::string out;
+	out.reserve((size + 2) / 3 * 4);
+
+	for (size_t i = 0; i < size; i += 3)
+	{
+		unsigned int chunk = data[i] << 16;
+		if (i + 1 < size) chunk |= data[i + 1] << 8;
+		if (i + 2 < size) chunk |= data[i + 2];
+
+		out += Base64Alphabet[(chunk >> 18) & 0x3F];
+		out += Base64Alphabet[(chunk >> 12) & 0x3F];
+		out += i + 1 < size ? Base64Alphabet[(chunk >> 6) & 0x3F] : '=';
+		out += i + 2 < size ? Base64Alphabet[chunk & 0x3F] : '=';
+	}
+
+	return out;
+}
+
+std::vector<unsigned char> DecodeBase64(const std::string& text)
+{
+	int table[256];
+	for (int i = 0; i < 256; i++) table[i] = -1;
+	for (int i = 0; i < 64; i++) table[(unsigned char)Base64Alphabet[i]] = i;
+
+	std::vector<unsigned char> out;
+	out.reserve(text.size() / 4 * 3);
+
+	unsigned int chunk = 0;
+	int bits = 0;
+
+	for (unsigned char c : text)
+	{
+		if (c == '=') break;
+		if (table[c] < 0) throw Json::LogicError("Invalid base64 data");
+
+		chunk = (chunk << 6) | table[c];
+		bits += 6;
+
+		if (bits >= 8)
+		{
+			bits -= 8;
+			out.push_back((unsigned char)(chunk >> bits));
+		}
+	}
+
+	return out;
+}
+
+// format == nullptr && binary: lossless, floats in a base64 blob
+Json::Value SaveLayerJSON(NeuronLayer* layer, const HalfFormat* format, bool binary)
 {
 	Json::Value root;
 
@@ -169,10 +223,62 @@ Json::Value SaveLayerJSON(NeuronLayer* layer)
 	root["bias"] = layer->bias;
 	root["neuron_count"] = layer->neuronCount;
 
+	if (format)
+	{
+		// little-endian 16-bit floats, row by row without padding
+		std::vector<unsigned short> half(layer->prevCount);
+		std::vector<unsigned char> bytes;
+		bytes.reserve((size_t)layer->neuronCount * layer->prevCount * 2);
+
+		for (int neuron = 0; neuron < layer->neuronCount; neuron++)
+		{
+			VectorAccelator::FloatToHalf((*layer)[neuron], half.data(), layer->prevCount, *format);
+
+			for (unsigned short value : half)
+			{
+				bytes.push_back(value & 0xFF);
+				bytes.push_back(value >> 8);
+			}
+		}
+
+		root["weight_format"] = *format == HalfFormat::BF16 ? "bf16" : "fp16";
+		root["weights_half"] = EncodeBase64(bytes.data(), bytes.size());
+
+		return root;
+	}
+
+	if (binary)
+	{
+		// little-endian 32-bit floats, row by row without padding
+		std::vector<unsigned char> bytes;
+		bytes.reserve((size_t)layer->neuronCount * layer->prevCount * 4);
+
+		for (int neuron = 0; neuron < layer->neuronCount; neuron++)
+		{
+			float_n* weight = (*layer)[neuron];
+
+			for (int i = 0; i < layer->prevCount; i++)
+			{
+				unsigned int bits;
+				memcpy(&bits, &weight[i], 4);
+
+				bytes.push_back(bits & 0xFF);
+				bytes.push_back((bits >> 8) & 0xFF);
+				bytes.push_back((bits >> 16) & 0xFF);
+				bytes.push_back(bits >> 24);
+			}
+		}
+
+		root["weights_fp32"] = EncodeBase64(bytes.data(), bytes.size());
+
+		return root;
+	}
+
 	// neuron data
-	for (auto& weight : layer->weightList)
+	for (int neuron = 0; neuron < layer->neuronCount; neuron++)
 	{
 		Json::Value weights;
+		float_n* weight = (*layer)[neuron];
 		for (int i = 0; i < layer->prevCount; i++)
 			weights.append(weight[i]);
 		root["weights"].append(weights);
@@ -181,7 +287,7 @@ Json::Value SaveLayerJSON(NeuronLayer* layer)
 	return root;
 }
 
-ProcessState NetworkDataParser::SaveNetworkDataJSON(FCNetwork* network, std::string path)
+ProcessState SaveNetworkJSON(FCNetwork* network, std::string path, const HalfFormat* format, bool binary)
 {
 	try
 	{
@@ -197,11 +303,11 @@ ProcessState NetworkDataParser::SaveNetworkDataJSON(FCNetwork* network, std::str
 		root["hidden_layer_count"] = network->hiddenLayerCount;
 
 		// out layer
-		root["out_layer_data"] = SaveLayerJSON(&network->outLayer);
+		root["out_layer_data"] = SaveLayerJSON(&network->outLayer, format, binary);
 
 		// hidden layers
 		for (auto& layer : network->hiddenLayerList)
-			root["hidden_layer_data"].append(SaveLayerJSON(&layer));
+			root["hidden_layer_data"].append(SaveLayerJSON(&layer, format, binary));
 
 		// write json to string
 		std::string content = Json::FastWriter().write(root);
@@ -221,6 +327,21 @@ ProcessState NetworkDataParser::SaveNetworkDataJSON(FCNetwork* network, std::str
 	}
 }
 
+ProcessState NetworkDataParser::SaveNetworkDataJSON(FCNetwork* network, std::string path)
+{
+	return SaveNetworkJSON(network, path, nullptr, false);
+}
+
+ProcessState NetworkDataParser::SaveNetworkDataJSON(FCNetwork* network, std::string path, HalfFormat format)
+{
+	return SaveNetworkJSON(network, path, &format, false);
+}
+
+ProcessState NetworkDataParser::SaveNetworkDataJSONBinary(FCNetwork* network, std::string path)
+{
+	return SaveNetworkJSON(network, path, nullptr, true);
+}
+
 void ThrowLogicError(std::string what)
 {
 	throw Json::LogicError(what);
@@ -244,6 +365,51 @@ Network::NeuronLayer GetLayerJSON(Json::Value val)
 	
 	layer.bias = bias;
 
+	if (val.isMember("weights_half"))
+	{
+		std::string formatName = GetMember(val, "weight_format").asString();
+		if (formatName != "fp16" && formatName != "bf16")
+			ThrowLogicError("Unknown weight format: " + formatName);
+
+		HalfFormat format = formatName == "bf16" ? HalfFormat::BF16 : HalfFormat::FP16;
+
+		std::vector<unsigned char> bytes = DecodeBase64(val["weights_half"].asString());
+		if (bytes.size() != (size_t)neuronCount * prevCount * 2)
+			ThrowLogicError("Weight data size mismatch");
+
+		std::vector<unsigned short> half(prevCount);
+
+		for (int i = 0; i < neuronCount; i++)
+		{
+			const unsigned char* row = bytes.data() + (size_t)i * prevCount * 2;
+			for (int j = 0; j < prevCount; j++)
+				half[j] = row[j * 2] | (row[j * 2 + 1] << 8);
+
+			VectorAccelator::HalfToFloat(half.data(), layer[i], prevCount, format);
+		}
+
+		return layer;
+	}
+
+	if (val.isMember("weights_fp32"))
+	{
+		std::vector<unsigned char> bytes = DecodeBase64(val["weights_fp32"].asString());
+		if (bytes.size() != (size_t)neuronCount * prevCount * 4)
+			ThrowLogicError("Weight data size mismatch");
+
+		for (int i = 0; i < neuronCount; i++)
+		{
+			const unsigned char* row = bytes.data() + (size_t)i * prevCount * 4;
+			for (int j = 0; j < prevCount; j++)
+			{
+				unsigned int bits = row[j * 4] | (row[j * 4 + 1] << 8) | (row[j * 4 + 2] << 16) | ((unsigned int)row[j * 4 + 3] << 24);
+				memcpy(&layer[i][j], &bits, 4);
+			}
+		}
+
+		return layer;
+	}
+
 	for (int i = 0; i < neuronCount; i++)
 	{
 		Json::Value& weights = val["weights"][i];
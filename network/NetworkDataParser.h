@@ -7,6 +7,7 @@
 #include"NetworkFramework.h"
 
 #include "ProcessState.h"
+#include "VectorAccelator.h"
 
 namespace Network
 {
@@ -29,6 +30,16 @@ namespace Network
 		//static ProcessState ReadNetworkData(Network::Connectivity::FullConnNetwork** network, std::string path);
 
 		static ProcessState SaveNetworkDataJSON(Network::Connectivity::FullConnNetwork* network, std::string path);
+
+		/// <summary>
+		/// Save with weights stored as 16-bit floats in a base64 blob, half the size of the float file and much faster to parse
+		/// </summary>
+		static ProcessState SaveNetworkDataJSON(Network::Connectivity::FullConnNetwork* network, std::string path, HalfFormat format);
+
+		/// <summary>
+		/// Lossless save with weights stored as 32-bit floats in a base64 blob, much faster to write and parse than the plain file
+		/// </summary>
+		static ProcessState SaveNetworkDataJSONBinary(Network::Connectivity::FullConnNetwork* network, std::string path);
 		static ProcessState ReadNetworkDataJSON(Network::Connectivity::FullConnNetwork** network, std::string path);
 	};
 }
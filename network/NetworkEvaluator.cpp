@@ -0,0 +1,140 @@
+#include "NetworkEvaluator.h"
+#include "VectorAccelator.h"
+#include "MatrixAccelator.h"
+#include "ProgressTimer.h"
+#include "Deterministic.h"
+
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+
+using namespace Network;
+using namespace Network::Connectivity;
+
+NetworkEvaluator::NetworkEvaluator(FullConnNetwork* src, int batchSize, int threadCount) :pool(threadCount), random(Deterministic::Engine(RandomStream::Estimate))
+{
+	if (batchSize <= 0)
+		throw std::exception("Invalid Parameters");
+
+	source = src;
+	this->batchSize = batchSize;
+
+	// batches stay allocated between evaluations
+	for (int i = 0; i < pool.Count(); i++)
+		batches.push_back(new FullConnNetworkBatch(source, batchSize));
+}
+
+NetworkEvaluator::~NetworkEvaluator()
+{
+	for (auto& item : batches)
+	{
+		item->FreeData();
+		delete item;
+	}
+}
+
+EvaluationResult NetworkEvaluator::Evaluate(PatchStore& dataset)
+{
+	return Run(dataset, nullptr, dataset.Count());
+}
+
+EvaluationResult NetworkEvaluator::Estimate(PatchStore& dataset, int sampleCount)
+{
+	int total = dataset.Count();
+
+	if (sampleCount <= 0)
+		throw std::exception("Invalid Parameters");
+
+	if (sampleCount >= total)
+		return Evaluate(dataset);
+
+	// Floyd's algorithm, a uniform subset without touching every index of the dataset
+	std::unordered_set<int> chosen;
+	chosen.reserve(sampleCount);
+
+	for (int i = total - sampleCount; i < total; i++)
+	{
+		int pick = std::uniform_int_distribution<int>(0, i)(random);
+		chosen.insert(chosen.count(pick) ? i : pick);
+	}
+
+	// ascending order keeps reads of the dataset forward
+	subsample.assign(chosen.begin(), chosen.end());
+	std::sort(subsample.begin(), subsample.end());
+
+	EvaluationResult result = Run(dataset, subsample.data(), sampleCount);
+
+	if (sampleCount < 2)
+	{
+		result.confidence = INFINITY; // no spread to measure from a single sample
+		return result;
+	}
+
+	double sum = 0.0, squares = 0.0;
+	for (auto& item : partials)
+	{
+		sum += item.loss;
+		squares += item.lossSquares;
+	}
+
+	// sample variance, with the finite population correction for drawing without replacement
+	double variance = (squares - sum * sum / sampleCount) / (sampleCount - 1);
+	double correction = (double)(total - sampleCount) / (total - 1);
+
+	result.confidence = 1.96 * std::sqrt(std::max(0.0, variance) * correction / sampleCount);
+
+	return result;
+}
+
+EvaluationResult NetworkEvaluator::Run(PatchStore& dataset, const int* indices, int count)
+{
+	ProgressTimer timer;
+
+	// chunks are fixed batches whichever worker takes them, so every sample goes through the same products on every run
+	int chunks = (count + batchSize - 1) / batchSize;
+	partials.assign(chunks, Partial());
+
+	pool.Run(chunks, 1, [&](int worker, int firstChunk, int lastChunk)
+	{
+		auto& batch = *batches[worker];
+		bool serial = MatrixAccelator::SetThreadSerial(true); // the pool already occupies every core
+
+		batch.FetchBias();
+
+		for (int chunk = firstChunk; chunk < lastChunk; chunk++)
+		{
+			int begin = chunk * batchSize;
+			int end = std::min(count, begin + batchSize);
+
+			dataset.Gather(indices, begin, end - begin, batch.GetInput(0), batch.inLayer.valueStride, batch.GetTarget(0), batch.outLayer.valueStride);
+
+			batch.ForwardTransmit(end - begin);
+
+			for (int i = 0; i < end - begin; i++)
+			{
+				double sample = VectorAccelator::SquaredDistance(batch.GetOutput(i), batch.GetTarget(i), batch.outLayer.neuronCount);
+				partials[chunk].loss += sample;
+				partials[chunk].lossSquares += sample * sample;
+			}
+		}
+
+		MatrixAccelator::SetThreadSerial(serial);
+	});
+
+	double total = 0.0;
+	for (auto& item : partials)
+		total += item.loss;
+
+	EvaluationResult result;
+	result.sampleCount = count;
+	result.loss = count > 0 ? total / count : 0.0;
+	result.confidence = 0.0;
+
+	double meanSquaredError = result.loss / source->outNeuronCount;
+	result.psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(1.0 / meanSquaredError) : INFINITY;
+
+	long long time = timer.Count();
+	result.samplesPerSecond = time > 0 ? count * 1e9 / time : 0.0;
+
+	return result;
+}
@@ -0,0 +1,74 @@
+#ifndef _NETWORK_EVALUATOR_H_
+#define _NETWORK_EVALUATOR_H_
+
+#include <vector>
+#include <random>
+
+#include "NetworkFramework.h"
+#include "WorkerPool.h"
+#include "../PatchStore.h"
+
+namespace Network
+{
+	namespace Connectivity
+	{
+		struct EvaluationResult
+		{
+			double loss; // mean over samples of the summed squared error, as GetLoss
+			double psnr; // dB, for pixel values in [0, 1]
+			double confidence; // half-width of the 95% confidence interval of loss, 0 when every sample was evaluated
+			double samplesPerSecond;
+			int sampleCount; // samples evaluated
+		};
+
+		// Reusable loss evaluation over image datasets
+		// Batched forward passes on a worker pool, every batch sums into its own partial, reduced in order at the end
+		// so results don't depend on which worker took which batch
+		class NetworkEvaluator
+		{
+		public:
+			FullConnNetwork* source;
+			int batchSize; // samples per forward pass
+
+			/// <summary>
+			/// threadCount includes the calling thread, 0 for one per hardware thread
+			/// </summary>
+			NetworkEvaluator(FullConnNetwork* src, int batchSize = 64, int threadCount = 0);
+			~NetworkEvaluator();
+
+			NetworkEvaluator(const NetworkEvaluator&) = delete;
+			NetworkEvaluator& operator=(const NetworkEvaluator&) = delete;
+
+			/// <summary>
+			/// Loss, PSNR and throughput of the network over every patch of the store whatever its order, the network is left untouched
+			/// </summary>
+			EvaluationResult Evaluate(PatchStore& dataset);
+
+			/// <summary>
+			/// Unbiased estimate from a random subsample of sampleCount samples, drawn without replacement on every call
+			/// Falls back to Evaluate when the subsample would cover the dataset
+			/// </summary>
+			EvaluationResult Estimate(PatchStore& dataset, int sampleCount);
+
+		private:
+			// one cache line per batch
+			struct alignas(64) Partial
+			{
+				double loss = 0.0;
+				double lossSquares = 0.0; // for the variance of subsample estimates
+			};
+
+			WorkerPool pool;
+			std::vector<FullConnNetworkBatch*> batches;
+			std::vector<Partial> partials;
+
+			std::mt19937 random;
+			std::vector<int> subsample; // indices drawn by the last Estimate
+
+			// indices == nullptr evaluates samples [0, count)
+			EvaluationResult Run(PatchStore& dataset, const int* indices, int count);
+		};
+	}
+}
+
+#endif
@@ -7,6 +7,7 @@
 #include <float.h>
 
 #include "VectorAccelator.h"
+#include "MatrixAccelator.h"
 
 using namespace Network::Connectivity;
 using namespace Network::Algorithm;
@@ -28,6 +29,10 @@ FullConnNetwork::FullConnNetwork(int inNeuronCount, int outNeuronCount, int hidd
 	this->learningRate = learningRate;
 	this->loss = 0.0;
 	this->targetData = new float_n[outNeuronCount];
+	this->optimizerStep = 0;
+	this->mixedPrecision = false;
+	this->halfFormat = HalfFormat::BF16;
+	this->loaderStall = 0;
 
 	this->ActivateFunc = ActivateFunc;
 
@@ -64,6 +69,10 @@ FullConnNetwork::FullConnNetwork(int inNeuronCount, NeuronLayer outLayer, int hi
 
 	this->loss = 0.0;
 	this->targetData = new float_n[outNeuronCount];
+	this->optimizerStep = 0;
+	this->mixedPrecision = false;
+	this->halfFormat = HalfFormat::BF16;
+	this->loaderStall = 0;
 
 	ForwardActive = forwardFuncList[(int)ActivateFunc];
 	BackwardActive = backwardFuncList[(int)ActivateFunc];
@@ -76,12 +85,7 @@ FullConnNetwork::FullConnNetwork(int inNeuronCount, NeuronLayer outLayer, int hi
 
 float_n FullConnNetwork::GetLoss()
 {
-	loss = 0.0;
-
-	for (int i = 0; i < outNeuronCount; i++)
-	{
-		loss += (outLayer.value[i] - targetData[i]) * (outLayer.value[i] - targetData[i]);
-	}
+	loss = VectorAccelator::SquaredDistance(outLayer.value, targetData, outNeuronCount);
 
 	return loss;
 }
@@ -94,6 +98,8 @@ void FullConnNetwork::RandomizeAllWeights(float_n min, float_n max)
 	{
 		layer.RandomizeWeightAndBias(min, max);
 	}
+
+	SetMixedPrecision(mixedPrecision, halfFormat);
 }
 
 void FullConnNetwork::SetAllWeights(float_n weight)
@@ -105,6 +111,54 @@ void FullConnNetwork::SetAllWeights(float_n weight)
 	{
 		layer.InitAllWeights(weight);
 	}
+
+	SetMixedPrecision(mixedPrecision, halfFormat);
+}
+
+void FullConnNetwork::SetOptimizer(OptimizerSettings settings)
+{
+	optimizer = settings;
+	optimizerStep = 0;
+
+	// the input layer has no weights to update
+	Optimizer::ResetState(outLayer, settings.type);
+
+	for (auto& layer : hiddenLayerList)
+		Optimizer::ResetState(layer, settings.type);
+}
+
+void FullConnNetwork::SetMixedPrecision(bool enable, HalfFormat format)
+{
+	mixedPrecision = enable;
+	halfFormat = format;
+
+	// the input layer has no weights to transmit through
+	auto prepare = [&](NeuronLayer& layer)
+	{
+		if (!enable)
+		{
+			AlignedFree((float_n*)layer.halfWeights);
+			layer.halfWeights = nullptr;
+			return;
+		}
+
+		if (!layer.halfWeights)
+			layer.halfWeights = (unsigned short*)AlignedAlloc(((size_t)layer.neuronCount * layer.stride + 1) / 2);
+
+		RefreshHalfWeights(layer);
+	};
+
+	prepare(outLayer);
+
+	for (auto& layer : hiddenLayerList)
+		prepare(layer);
+}
+
+void FullConnNetwork::RefreshHalfWeights(NeuronLayer& layer)
+{
+	// padding columns narrow from zeros to zeros
+	if (layer.halfWeights)
+		VectorAccelator::FloatToHalf(layer.weights, layer.halfWeights, (size_t)layer.neuronCount * layer.stride, halfFormat);
 }
 
 void FullConnNetwork::PushDataDouble(double* data)
@@ -122,24 +176,16 @@ void Network::Connectivity::FullConnNetwork::PushDataFloat(float_n* data)
 
 void FullConnNetwork::ForwardTransmitLayer(NeuronLayer& obj, NeuronLayer& prev)
 {
-	for (int i = 0; i < obj.neuronCount; i++)
-	{
-		obj.value[i] = VectorAccelator::Dot(obj[i], prev.value, obj.prevCount);
+	MatrixEpilogue epilogue = LayerEpilogue(ActivateFunc, 1.0f / (float_n)obj.prevCount, obj.bias / (float_n)obj.prevCount);
 
-		obj.value[i] += obj.bias;
-		obj.value[i] = (*ForwardActive)(obj.value[i] / (float_n)obj.prevCount);
-	}
+	MatrixAccelator::Gemv(MatrixOp::NoTrans, obj.neuronCount, obj.prevCount, 1.0f, obj[0], obj.stride, prev.value, 0.0f, obj.value, &epilogue);
 }
 
 void FullConnNetwork::ForwardTransmitLayer(NeuronLayerInstance& obj, NeuronLayerInstance& prev)
 {
-	for (int i = 0; i < obj.neuronCount; i++)
-	{
-		obj.value[i] = VectorAccelator::Dot(obj[i], prev.value, obj.prevCount);
+	MatrixEpilogue epilogue = LayerEpilogue(ActivateFunc, 1.0f / (float_n)obj.prevCount, obj.bias / (float_n)obj.prevCount);
 
-		obj.value[i] += obj.bias;
-		obj.value[i] = (*ForwardActive)(obj.value[i] / (float_n)obj.prevCount);
-	}
+	MatrixAccelator::Gemv(MatrixOp::NoTrans, obj.neuronCount, obj.prevCount, 1.0f, obj[0], obj.stride, prev.value, 0.0f, obj.value, &epilogue);
 }
 
 void FullConnNetwork::ForwardTransmit()
@@ -151,13 +197,9 @@ void FullConnNetwork::ForwardTransmit()
 
 	NeuronLayer& lastHiddenLayer = hiddenLayerList[hiddenLayerCount - 1];
 
-	for (int i = 0; i < outLayer.neuronCount; i++)
-	{
-		outLayer.value[i] = VectorAccelator::Dot(outLayer[i], lastHiddenLayer.value, outLayer.prevCount);
+	MatrixEpilogue epilogue = LayerEpilogue(ActivateFunctionType::Linear, 1.0f / (float_n)outLayer.prevCount, outLayer.bias / (float_n)outLayer.prevCount);
 
-		outLayer.value[i] += outLayer.bias;
-		outLayer.value[i] = outLayer.value[i] / outLayer.prevCount;
-	}
+	MatrixAccelator::Gemv(MatrixOp::NoTrans, outLayer.neuronCount, outLayer.prevCount, 1.0f, outLayer[0], outLayer.stride, lastHiddenLayer.value, 0.0f, outLayer.value, &epilogue);
 
 	if (outLayerSoftMax) SoftMax(outLayer);
 }
@@ -181,41 +223,83 @@ void FullConnNetwork::ForwardTransmit(NeuronLayerInstance& inLayer, NeuronLayerI
 
 	NeuronLayerInstance& lastHiddenLayer = hiddenLayers[count - 1];
 
-	for (int i = 0; i < outLayer.neuronCount; i++)
-	{
-		outLayer.value[i] = VectorAccelator::Dot(outLayer[i], lastHiddenLayer.value, outLayer.prevCount);
+	MatrixEpilogue epilogue = LayerEpilogue(ActivateFunctionType::Linear, 1.0f / (float_n)outLayer.prevCount, outLayer.bias / (float_n)outLayer.prevCount);
 
-		outLayer.value[i] += outLayer.bias;
-		outLayer.value[i] = outLayer.value[i] / outLayer.prevCount;
-	}
+	MatrixAccelator::Gemv(MatrixOp::NoTrans, outLayer.neuronCount, outLayer.prevCount, 1.0f, outLayer[0], outLayer.stride, lastHiddenLayer.value, 0.0f, outLayer.value, &epilogue);
 
 	if (outLayerSoftMax) SoftMax(outLayer);
 }
 
-void FullConnNetwork::BackwardTransmitLayer(NeuronLayer& obj, NeuronLayer& last)
+// Products of a layer's weights with every sample of the previous layer, activated by f
+// C = A * op(weights), through the 16-bit copy of the weights when the layer has one
+// BF16 products also round A to BF16, FP16 weights are widened and A stays float
+static void LayerGemm(MatrixOp transB, int M, int N, int K, const float_n* A, int lda, Network::NeuronLayer& layer, HalfFormat format,
+	float_n* C, int ldc, const MatrixEpilogue* epilogue = nullptr)
 {
-	for (int i = 0; i < obj.neuronCount; i++)
-	{
-		obj.error[i] = 0.0;
+	if (!layer.halfWeights)
+		MatrixAccelator::Gemm(MatrixOp::NoTrans, transB, M, N, K, 1.0f, A, lda, layer[0], layer.stride, 0.0f, C, ldc, epilogue);
+	else if (format == HalfFormat::BF16)
+		MatrixAccelator::GemmBF16(MatrixOp::NoTrans, transB, M, N, K, 1.0f, A, lda, layer.halfWeights, layer.stride, 0.0f, C, ldc, epilogue);
+	else
+		MatrixAccelator::Gemm(MatrixOp::NoTrans, transB, M, N, K, 1.0f, A, lda, layer.halfWeights, format, layer.stride, 0.0f, C, ldc, epilogue);
+}
 
-		for (int j = 0; j < last.neuronCount; j++)
-		{
-			obj.error[i] += last.error[j] * last[j][i];
-		}
+static void MultiplyBatch(Network::NeuronLayerBatch& obj, Network::NeuronLayerBatch& prev, int count, Network::ActivateFunctionType type, HalfFormat format)
+{
+	MatrixEpilogue epilogue = LayerEpilogue(type, 1.0f / (float_n)obj.prevCount, obj.bias / (float_n)obj.prevCount);
+
+	// value = f((prev.value * weights^T + bias) / prevCount)
+	LayerGemm(MatrixOp::Trans, count, obj.neuronCount, obj.prevCount, prev.value, prev.valueStride, *obj.source, format,
+		obj.value, obj.valueStride, &epilogue);
+}
+
+void FullConnNetwork::ForwardTransmitLayer(NeuronLayerBatch& obj, NeuronLayerBatch& prev, int count)
+{
+	MultiplyBatch(obj, prev, count, ActivateFunc, halfFormat);
+}
+
+void FullConnNetwork::ForwardTransmit(NeuronLayerBatch& inLayer, NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count)
+{
+	int layerCount = hiddenLayers.size();
+
+	// validation
+	if (inLayer.source != &this->inLayer || outLayer.source != &this->outLayer)
+		throw std::exception("Source Mismatch!");
+
+	for (int i = 0; i < layerCount; i++)
+		if (hiddenLayers[i].source != &this->hiddenLayerList[i])
+			throw std::exception("Source Mismatch!");
+
+	if (count > inLayer.batchSize)
+		throw std::exception("Batch Overflow!");
+
+	for (int i = 0; i < layerCount; i++)
+	{
+		ForwardTransmitLayer(hiddenLayers[i], i == 0 ? inLayer : hiddenLayers[i - 1], count);
 	}
+
+	MultiplyBatch(outLayer, hiddenLayers[layerCount - 1], count, ActivateFunctionType::Linear, halfFormat);
+
+	if (outLayerSoftMax) SoftMax(outLayer, count);
+}
+
+void FullConnNetwork::BackwardTransmitLayer(NeuronLayer& obj, NeuronLayer& last)
+{
+	// error = weights^T * last.error
+	MatrixAccelator::Gemv(MatrixOp::Trans, last.neuronCount, last.prevCount, 1.0f, last[0], last.stride, last.error, 0.0f, obj.error);
 }
 
 void FullConnNetwork::BackwardTransmitLayer(NeuronLayerInstance& obj, NeuronLayerInstance& last)
 {
-	for (int i = 0; i < obj.neuronCount; i++)
-	{
-		obj.error[i] = 0.0;
+	// error = weights^T * last.error
+	MatrixAccelator::Gemv(MatrixOp::Trans, last.neuronCount, last.prevCount, 1.0f, last[0], last.stride, last.error, 0.0f, obj.error);
+}
 
-		for (int j = 0; j < last.neuronCount; j++)
-		{
-			obj.error[i] += last.error[j] * last[j][i];
-		}
-	}
+void FullConnNetwork::BackwardTransmitLayer(NeuronLayerBatch& obj, NeuronLayerBatch& last, int count)
+{
+	// error = last.error * weights, the weight matrix is packed row by row
+	LayerGemm(MatrixOp::NoTrans, count, obj.neuronCount, last.neuronCount, last.error, last.valueStride, *last.source, halfFormat,
+		obj.error, obj.valueStride);
 }
 
 void FullConnNetwork::BackwardTransmit()
@@ -237,56 +321,118 @@ void FullConnNetwork::BackwardTransmit()
 
 void FullConnNetwork::UpdateLayerWeights(NeuronLayer& layer, NeuronLayer& lastLayer)
 {
-	for (int i = 0; i < layer.neuronCount; i++)
-	{
-		float_n coeff = learningRate * (*BackwardActive)(layer.value[i]) * layer.error[i]; // common coeff
+	std::vector<float_n> coeff(layer.neuronCount);
 
-		layer.bias += learningRate * (*BackwardActive)(layer.bias) * layer.error[i]; // tweak bias
+	// common coeff and bias tweak
+	WeightUpdateCoefficients(ActivateFunc, layer.value, layer.error, layer.neuronCount, learningRate, coeff.data(), layer.bias);
 
-		for (int j = 0; j < layer.prevCount; j++)
-		{
-			layer[i][j] += coeff * lastLayer.value[j];
-		}
+	// weights += coeff * lastLayer.value^T
+	MatrixAccelator::Ger(layer.neuronCount, layer.prevCount, 1.0f, coeff.data(), lastLayer.value, layer[0], layer.stride);
+
+	RefreshHalfWeights(layer);
+}
+
+void FullConnNetwork::UpdateWeights()
+{
+	UpdateLayerWeights(outLayer, hiddenLayerList[hiddenLayerCount - 1]); // update outlayer
+
+	for (int i = 0; i < hiddenLayerCount; i++)
+	{
+		UpdateLayerWeights(hiddenLayerList[i], i == 0 ? inLayer : hiddenLayerList[i - 1]);
 	}
 }
 
-void FullConnNetwork::computeAverage(float_n count)
+void FullConnNetwork::ComputeLayerDirection(NeuronLayerBatch& layer, NeuronLayerBatch& lastLayer, int count)
 {
-	for (auto& layer : hiddenLayerList)
+	float_n* errorSum = layer.Scratch();
+	memset(errorSum, 0, sizeof(float_n) * layer.neuronCount);
+
+	for (int sample = 0; sample < count; sample++)
+		VectorAccelator::Axpy(1.0f, layer.SampleError(sample), errorSum, layer.neuronCount);
+
+	for (int sample = 0; sample < count; sample++)
+		LayerDelta(ActivateFunc, layer.Sample(sample), layer.SampleError(sample), layer.neuronCount, layer.SampleError(sample));
+
+	// direction = delta^T * lastLayer.value, summed rather than averaged so directions of several batches add up
+	MatrixAccelator::Gemm(MatrixOp::Trans, MatrixOp::NoTrans, layer.neuronCount, layer.prevCount, count,
+		1.0f, layer.error, layer.valueStride, lastLayer.value, lastLayer.valueStride,
+		0.0f, layer.Direction(), layer.source->stride);
+
+	layer.biasDirection = BiasDirection(ActivateFunc, errorSum, layer.neuronCount, layer.bias);
+}
+
+void FullConnNetwork::ApplyLayerDirection(NeuronLayerBatch& layer, int count, long long step)
+{
+	float_n* direction = layer.Direction();
+	float_n scale = 1.0f / (float_n)count;
+
+	if (optimizer.type == OptimizerType::SGD)
 	{
-		for (int i = 0; i < layer.neuronCount; i++)
-		{
-			layer.value[i] /= count;
-			layer.error[i] /= count;
-		}
+		// padding columns of the direction are zero, the whole matrix is one vector
+		VectorAccelator::Axpy(learningRate * scale, direction, layer[0], (size_t)layer.neuronCount * layer.source->stride);
+		layer.source->bias += learningRate * scale * layer.biasDirection;
 	}
-	for (int i = 0; i < inLayer.neuronCount; i++)
+	else
 	{
-		inLayer.value[i] /= count;
-		inLayer.error[i] /= count;
+		VectorAccelator::Scale(scale, direction, (size_t)layer.neuronCount * layer.source->stride);
+		Optimizer::Step(optimizer, step, learningRate, *layer.source, direction, scale * layer.biasDirection);
 	}
-	for (int i = 0; i < outLayer.neuronCount; i++)
+
+	RefreshHalfWeights(*layer.source);
+}
+
+void FullConnNetwork::ApplyLayerDirectionRelaxed(NeuronLayerBatch& layer, int count)
+{
+	float_n scale = learningRate / (float_n)count;
+
+	// Hogwild: other workers read and step the same weights meanwhile with plain loads and stores, a step may be lost
+	VectorAccelator::Axpy(scale, layer.Direction(), layer[0], (size_t)layer.neuronCount * layer.source->stride);
+	std::atomic_ref<float_n>(layer.source->bias).fetch_add(scale * layer.biasDirection, std::memory_order_relaxed);
+}
+
+void FullConnNetwork::ComputeDirections(NeuronLayerBatch& inLayer, NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count)
+{
+	int layerCount = hiddenLayers.size();
+
+	ComputeLayerDirection(outLayer, hiddenLayers[layerCount - 1], count);
+
+	for (int i = 0; i < layerCount; i++)
 	{
-		outLayer.value[i] /= count;
-		outLayer.error[i] /= count;
+		ComputeLayerDirection(hiddenLayers[i], i == 0 ? inLayer : hiddenLayers[i - 1], count);
 	}
 }
 
-void Network::Connectivity::FullConnNetwork::ClearSum()
+void FullConnNetwork::ApplyDirections(NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count)
 {
-	inLayer.ClearValues();
-	outLayer.ClearValues();
-	for (auto& item : hiddenLayerList)
-		item.ClearValues();
+	if (count <= 0)
+		return;
+
+	long long step = ++optimizerStep;
+
+	ApplyLayerDirection(outLayer, count, step);
+
+	for (auto& layer : hiddenLayers)
+	{
+		ApplyLayerDirection(layer, count, step);
+	}
 }
 
-void FullConnNetwork::UpdateWeights()
+void FullConnNetwork::ApplyDirectionsRelaxed(NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count)
 {
-	UpdateLayerWeights(outLayer, hiddenLayerList[hiddenLayerCount - 1]); // update outlayer
+	if (count <= 0)
+		return;
 
-	for (int i = 0; i < hiddenLayerCount; i++)
+	if (optimizer.type != OptimizerType::SGD)
+		throw std::exception("Optimizer Not Supported!");
+
+	if (mixedPrecision)
+		throw std::exception("Mixed Precision Not Supported!");
+
+	ApplyLayerDirectionRelaxed(outLayer, count);
+
+	for (auto& layer : hiddenLayers)
 	{
-		UpdateLayerWeights(hiddenLayerList[i], i == 0 ? inLayer : hiddenLayerList[i - 1]);
+		ApplyLayerDirectionRelaxed(layer, count);
 	}
 }
 
@@ -449,14 +595,6 @@ void Network::Connectivity::FullConnNetworkInstance::BackwardTransmit()
 	}
 }
 
-void Network::Connectivity::FullConnNetworkInstance::FeedBack()
-{
-	inLayer.FeedBack();
-	outLayer.FeedBack();
-	for (auto& item : hiddenLayerList)
-		item.FeedBack();
-}
-
 void Network::Connectivity::FullConnNetworkInstance::FetchBias()
 {
 	for (auto& item : hiddenLayerList)
@@ -466,9 +604,165 @@ void Network::Connectivity::FullConnNetworkInstance::FetchBias()
 
 float_n Network::Connectivity::FullConnNetworkInstance::GetLoss()
 {
-	float_n total = 0;
-	for (int i = 0; i < outLayer.neuronCount; i++)
-		total += (outLayer.value[i] - target[i]) * (outLayer.value[i] - target[i]);
+	return VectorAccelator::SquaredDistance(outLayer.value, target, outLayer.neuronCount);
+}
+
+Network::Connectivity::FullConnNetworkBatch::FullConnNetworkBatch(FullConnNetwork* src, int batchSize)
+{
+	if (batchSize <= 0)
+		throw std::exception("Invalid Parameters");
+
+	source = src;
+	this->batchSize = batchSize;
+
+	inLayer = NeuronLayerBatch(&source->inLayer, batchSize);
+	outLayer = NeuronLayerBatch(&source->outLayer, batchSize);
+
+	for (auto& layer : source->hiddenLayerList)
+		hiddenLayerList.push_back(NeuronLayerBatch(&layer, batchSize));
+
+	target = AlignedAlloc((size_t)batchSize * outLayer.valueStride);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::PushData(int index, float_n* data)
+{
+	memcpy(inLayer.Sample(index), data, sizeof(float_n) * inLayer.neuronCount);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::PushTarget(int index, float_n* target)
+{
+	memcpy(GetTarget(index), target, sizeof(float_n) * outLayer.neuronCount);
+}
+
+float_n* Network::Connectivity::FullConnNetworkBatch::GetInput(int index)
+{
+	return inLayer.Sample(index);
+}
+
+float_n* Network::Connectivity::FullConnNetworkBatch::GetOutput(int index)
+{
+	return outLayer.Sample(index);
+}
+
+float_n* Network::Connectivity::FullConnNetworkBatch::GetTarget(int index)
+{
+	return target + (size_t)index * outLayer.valueStride;
+}
+
+void Network::Connectivity::FullConnNetworkBatch::SwapData(float_n*& input, float_n*& target)
+{
+	std::swap(inLayer.value, input);
+	std::swap(this->target, target);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::FreeData()
+{
+	inLayer.Free();
+	outLayer.Free();
+
+	for (auto& item : hiddenLayerList)
+		item.Free();
+
+	hiddenLayerList.clear();
+
+	AlignedFree(target);
+}
+
+double Network::Connectivity::FullConnNetworkBatch::GetLoss(int count)
+{
+	double total = 0.0;
+	for (int sample = 0; sample < count; sample++)
+		total += VectorAccelator::SquaredDistance(GetOutput(sample), GetTarget(sample), outLayer.neuronCount);
 
 	return total;
 }
+
+void Network::Connectivity::FullConnNetworkBatch::ForwardTransmit(int count)
+{
+	source->ForwardTransmit(inLayer, outLayer, hiddenLayerList, count);
+}
+
+// error = target - value of the output layer, or its softmax counterpart
+static void OutputError(FullConnNetworkBatch& batch, int count)
+{
+	auto& outLayer = batch.outLayer;
+
+	if (batch.source->outLayerSoftMax)
+		SoftMaxGetError(outLayer, batch.target, count);
+	else
+		for (int sample = 0; sample < count; sample++)
+		{
+			float_n* value = outLayer.Sample(sample);
+			float_n* error = outLayer.SampleError(sample);
+			float_n* sampleTarget = batch.GetTarget(sample);
+
+			for (int i = 0; i < outLayer.neuronCount; i++)
+			{
+				error[i] = sampleTarget[i] - value[i];
+			}
+		}
+}
+
+void Network::Connectivity::FullConnNetworkBatch::BackwardTransmit(int count)
+{
+	OutputError(*this, count);
+
+	for (int i = hiddenLayerList.size() - 1; i >= 0; i--)
+	{
+		source->BackwardTransmitLayer(hiddenLayerList[i], i == hiddenLayerList.size() - 1 ? outLayer : hiddenLayerList[i + 1], count);
+	}
+}
+
+void Network::Connectivity::FullConnNetworkBatch::ComputeDirections(int count)
+{
+	source->ComputeDirections(inLayer, outLayer, hiddenLayerList, count);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::BackwardDirections(int count, std::function<void(NeuronLayerBatch&)> ready)
+{
+	OutputError(*this, count);
+
+	// errors of a layer are turned into deltas by its direction, so they are passed down first
+	for (int i = hiddenLayerList.size() - 1; i >= 0; i--)
+	{
+		auto& last = i == hiddenLayerList.size() - 1 ? outLayer : hiddenLayerList[i + 1];
+
+		source->BackwardTransmitLayer(hiddenLayerList[i], last, count);
+		source->ComputeLayerDirection(last, hiddenLayerList[i], count);
+		ready(last);
+	}
+
+	source->ComputeLayerDirection(hiddenLayerList[0], inLayer, count);
+	ready(hiddenLayerList[0]);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::ApplyDirections(int count)
+{
+	source->ApplyDirections(outLayer, hiddenLayerList, count);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::ApplyDirectionsRelaxed(int count)
+{
+	source->ApplyDirectionsRelaxed(outLayer, hiddenLayerList, count);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::AddDirections(FullConnNetworkBatch& other)
+{
+	auto add = [](NeuronLayerBatch& layer, NeuronLayerBatch& item)
+	{
+		VectorAccelator::Axpy(1.0f, item.Direction(), layer.Direction(), (size_t)layer.neuronCount * layer.source->stride);
+		layer.biasDirection += item.biasDirection;
+	};
+
+	add(outLayer, other.outLayer);
+
+	for (int i = 0; i < hiddenLayerList.size(); i++)
+		add(hiddenLayerList[i], other.hiddenLayerList[i]);
+}
+
+void Network::Connectivity::FullConnNetworkBatch::FetchBias()
+{
+	for (auto& item : hiddenLayerList)
+		item.FetchBias();
+	outLayer.FetchBias();
+}
@@ -7,10 +7,15 @@
 
 #include "NetworkStructure.h"
 #include "NetworkData.h"
-#include "../Image.h"
+#include "NetworkOptimizer.h"
+#include "VectorAccelator.h"
+#include "../PatchStore.h"
+#include "../PatchSource.h"
 
 namespace Network
 {
+	class RingAllReduce;
+
 	namespace Connectivity
 	{
 		class FullConnNetwork
@@ -35,6 +40,14 @@ namespace Network
 			float_n learningRate, loss;
 			float_n* targetData;
 
+			OptimizerSettings optimizer;
+			long long optimizerStep; // minibatch steps taken with the current optimizer
+
+			bool mixedPrecision; // batches transmit through the 16-bit copies of the weights
+			HalfFormat halfFormat;
+
+			long long loaderStall; // ns the last TrainBatched waited for its next minibatch to be assembled
+
 			FullConnNetwork(int inNeuronCount, int outNeuronCount, int hiddenNeuronCount, int hiddenLayerCount, ActivateFunctionType activateFunc, float_n learningRate = 0.0, bool outLayerSoftMax = true);
 
 			FullConnNetwork(int inNeuronCount, NeuronLayer outLayer, int hiddenNeuronCount, int hiddenLayerCount, ActivateFunctionType activateFunc, float_n learningRate = 0.0, bool outLayerSoftMax = true);
@@ -45,6 +58,25 @@ namespace Network
 
 			void SetAllWeights(float_n weight);
 
+			/// <summary>
+			/// Select the optimizer of minibatch training, its state is cleared
+			/// Not to be called while training
+			/// </summary>
+			void SetOptimizer(OptimizerSettings settings);
+
+			/// <summary>
+			/// Mixed-precision training: batched forward and backward products read a 16-bit copy of the weights,
+			/// the float weights stay the master copy that updates and optimizer state work on
+			/// The copy is refreshed after every update. Hogwild TrainAsync rejects it: every worker would narrow whole layers
+			/// after each of its steps, while the others read them
+			/// </summary>
+			void SetMixedPrecision(bool enable, HalfFormat format = HalfFormat::BF16);
+
+			/// <summary>
+			/// Narrow the weights of a layer into its 16-bit copy, if mixed precision is on
+			/// </summary>
+			void RefreshHalfWeights(NeuronLayer& layer);
+
 			void PushDataDouble(double* data);
 			void PushDataFloat(float_n* data);
 			void PushTargetLabel(int label);
@@ -52,11 +84,31 @@ namespace Network
 
 			void ForwardTransmit();
 			void ForwardTransmit(NeuronLayerInstance& inLayer, NeuronLayerInstance& outLayer, std::vector<NeuronLayerInstance>& hiddenLayers);
+			void ForwardTransmit(NeuronLayerBatch& inLayer, NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count);
 
 			void BackwardTransmit();
 
 			void UpdateWeights();
 
+			/// <summary>
+			/// Sums over the samples of a batch that went through BackwardTransmit of delta * prev.value^T and of the bias direction,
+			/// into the direction buffers of the batch. Errors are turned into deltas in place, the network is left untouched
+			/// </summary>
+			void ComputeDirections(NeuronLayerBatch& inLayer, NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count);
+
+			/// <summary>
+			/// One optimizer step along the mean of directions summed over count samples, for SGD weights += learningRate / count * direction
+			/// </summary>
+			void ApplyDirections(NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count);
+
+			/// <summary>
+			/// Plain SGD step for Hogwild workers stepping the same network at once. Only the bias is added atomically:
+			/// weights are stepped and read by the other workers with plain loads and stores, a benign race on floats
+			/// where concurrent steps of a weight may interleave and a few may be lost
+			/// Throws for optimizers with state, which concurrent steps would corrupt, and in mixed precision, see SetMixedPrecision
+			/// </summary>
+			void ApplyDirectionsRelaxed(NeuronLayerBatch& outLayer, std::vector<NeuronLayerBatch>& hiddenLayers, int count);
+
 			int FindLargestOutput();
 
 			int GetResultNetworkData(NetworkData& data);
@@ -73,15 +125,50 @@ namespace Network
 			void ForwardTransmitLayer(NeuronLayer& obj, NeuronLayer& prev);
 			void BackwardTransmitLayer(NeuronLayer& obj, NeuronLayer& last);
 			void UpdateLayerWeights(NeuronLayer& layer, NeuronLayer& lastLayer);
+			void ComputeLayerDirection(NeuronLayerBatch& layer, NeuronLayerBatch& lastLayer, int count);
+			void ApplyLayerDirection(NeuronLayerBatch& layer, int count, long long step);
+			void ApplyLayerDirectionRelaxed(NeuronLayerBatch& layer, int count);
 
 			void ForwardTransmitLayer(NeuronLayerInstance& obj, NeuronLayerInstance& prev);
 			void BackwardTransmitLayer(NeuronLayerInstance& obj, NeuronLayerInstance& last);
 
-			void computeAverage(float_n count);
-			void ClearSum();
-
-			void TrainBatched(NetworkDataSet& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
-			void TrainBatched(std::vector<ImageDataset*>& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+			void ForwardTransmitLayer(NeuronLayerBatch& obj, NeuronLayerBatch& prev, int count);
+			void BackwardTransmitLayer(NeuronLayerBatch& obj, NeuronLayerBatch& last, int count);
+
+			/// <summary>
+			/// Minibatch gradient descent, every minibatch is split across a worker pool: each worker transmits its share as matrix products
+			/// and sums its directions into buffers of its own, the sums are added in a fixed pairwise tree and applied as one step
+			/// Returns the running loss: mean loss of the samples, each taken from the forward pass of its own step
+			/// Patches are visited in dataset.order, or the current epoch of a PatchSource is cut straight into the batches
+			/// The next minibatches are assembled on loader threads while the current one trains, see BatchLoader
+			/// </summary>
+			double TrainBatched(NetworkDataSet& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+			double TrainBatched(PatchStore& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+			double TrainBatched(PatchSource& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+
+			/// <summary>
+			/// Asynchronous training, workers step the shared weights without waiting for each other
+			/// Each worker takes a minibatch step of its own every localBatch samples, all workers meet every syncInterval samples
+			/// Staleness is bounded by localBatch samples per worker, the callback runs at every meeting
+			/// In deterministic mode workers step in lockstep instead: every round each worker sums the directions of its own
+			/// localBatch samples against the same weights, the sums meet in a fixed pairwise tree and are applied as one step
+			/// Hogwild steps are plain SGD in full precision, see ApplyDirectionsRelaxed,
+			/// other optimizers and mixed precision are only accepted in deterministic mode
+			/// Returns the running loss, as TrainBatched
+			/// </summary>
+			double TrainAsync(NetworkDataSet& dataset, int localBatch, int syncInterval, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+			double TrainAsync(PatchStore& dataset, int localBatch, int syncInterval, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+			double TrainAsync(PatchSource& dataset, int localBatch, int syncInterval, float_n learningRate, std::function<void(int, int)> callback = [](int, int) {});
+
+			/// <summary>
+			/// Data-parallel training across the processes of a ring, each training on the patches in shard.order, see PatchStore::Shard
+			/// Rank 0 hands out its weights and optimizer state first, every rank then takes the same number of steps:
+			/// batch directions are summed over the ring, each layer's sum starting while the layers below are still transmitted back,
+			/// and applied as one step of the global batch, so every rank holds the same weights throughout
+			/// Every rank must call it with the same batch size and learning rate, on a network of the same shape and optimizer
+			/// Returns the running loss over all shards, the callback reports progress through the local shard
+			/// </summary>
+			double TrainDistributed(PatchStore& shard, int batchSize, float_n learningRate, RingAllReduce& ring, std::function<void(int, int)> callback = [](int, int) {});
 		};
 
 		class FullConnNetworkInstance
@@ -109,11 +196,73 @@ namespace Network
 
 			void ForwardTransmit();
 			void BackwardTransmit();
-			void FeedBack();
 			void FetchBias();
 
 			float_n GetLoss();
 		};
+
+		// Transmits a batch of samples at once, each layer is computed as a matrix product
+		// so the weights are streamed once per batch instead of once per sample
+		class FullConnNetworkBatch
+		{
+		public:
+			// variables
+
+			FullConnNetwork* source;
+
+			int batchSize; // capacity, in samples
+
+			NeuronLayerBatch inLayer;
+			NeuronLayerBatch outLayer;
+			std::vector<NeuronLayerBatch> hiddenLayerList;
+
+			float_n* target; // row-major, same layout as outLayer.value
+
+			FullConnNetworkBatch(FullConnNetwork* src, int batchSize);
+
+			// Data Management
+
+			void PushData(int index, float_n* data);
+			void PushTarget(int index, float_n* target);
+			float_n* GetInput(int index);
+			float_n* GetOutput(int index);
+			float_n* GetTarget(int index);
+
+			/// <summary>
+			/// Trade the input and target matrices with two of the same row layout, so rows assembled elsewhere are read in place
+			/// Swapping back returns the batch its own matrices
+			/// </summary>
+			void SwapData(float_n*& input, float_n*& target);
+			void FreeData();
+
+			/// <summary>
+			/// Summed loss of the first count samples, after ForwardTransmit
+			/// </summary>
+			double GetLoss(int count);
+
+			// Transmission
+
+			void ForwardTransmit(int count);
+			void BackwardTransmit(int count);
+			void FetchBias();
+
+			// Minibatch steps, see FullConnNetwork::ComputeDirections
+
+			void ComputeDirections(int count);
+
+			/// <summary>
+			/// BackwardTransmit and ComputeDirections in one pass from the output layer down,
+			/// ready is called on each layer as soon as its directions are final, while the layers below are still pending
+			/// </summary>
+			void BackwardDirections(int count, std::function<void(NeuronLayerBatch&)> ready);
+			void ApplyDirections(int count);
+			void ApplyDirectionsRelaxed(int count);
+
+			/// <summary>
+			/// this += other, weight and bias directions of every layer
+			/// </summary>
+			void AddDirections(FullConnNetworkBatch& other);
+		};
 	}
 }
 
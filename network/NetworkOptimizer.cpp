@@ -0,0 +1,68 @@
+#include "NetworkOptimizer.h"
+#include "VectorAccelator.h"
+
+#include <cmath>
+#include <atomic>
+
+using namespace Network;
+
+void Network::Optimizer::ResetState(NeuronLayer& layer, OptimizerType type)
+{
+	AlignedFree(layer.moment);
+	AlignedFree(layer.velocity);
+
+	layer.moment = nullptr;
+	layer.velocity = nullptr;
+	layer.biasMoment = 0.0;
+	layer.biasVelocity = 0.0;
+
+	size_t count = (size_t)layer.neuronCount * layer.stride;
+
+	if (type != OptimizerType::SGD)
+		layer.moment = AlignedAlloc(count);
+
+	if (type == OptimizerType::Adam)
+		layer.velocity = AlignedAlloc(count);
+}
+
+void Network::Optimizer::Step(OptimizerSettings& settings, long long step, float_n learningRate, NeuronLayer& layer, const float_n* direction, float_n biasDirection)
+{
+	// padding columns have a zero direction, so they stay zero under every rule
+	unsigned int count = (unsigned int)((size_t)layer.neuronCount * layer.stride);
+	float_n biasStep;
+
+	switch (settings.type)
+	{
+	case OptimizerType::Momentum:
+	case OptimizerType::Nesterov:
+	{
+		bool nesterov = settings.type == OptimizerType::Nesterov;
+		VectorAccelator::MomentumStep(layer.weights, layer.moment, direction, count, learningRate, settings.momentum, nesterov);
+
+		layer.biasMoment = settings.momentum * layer.biasMoment + biasDirection;
+		biasStep = learningRate * (nesterov ? settings.momentum * layer.biasMoment + biasDirection : layer.biasMoment);
+		break;
+	}
+	case OptimizerType::Adam:
+	{
+		// bias correction folded into the step size and epsilon, keeps the kernel to one pass
+		double correction1 = 1.0 - std::pow((double)settings.beta1, (double)step);
+		double correction2 = std::sqrt(1.0 - std::pow((double)settings.beta2, (double)step));
+		float_n rate = (float_n)(learningRate * correction2 / correction1);
+		float_n epsilon = (float_n)(settings.epsilon * correction2);
+
+		VectorAccelator::AdamStep(layer.weights, layer.moment, layer.velocity, direction, count, rate, settings.beta1, settings.beta2, epsilon);
+
+		layer.biasMoment = settings.beta1 * layer.biasMoment + (1.0f - settings.beta1) * biasDirection;
+		layer.biasVelocity = settings.beta2 * layer.biasVelocity + (1.0f - settings.beta2) * biasDirection * biasDirection;
+		biasStep = rate * layer.biasMoment / (std::sqrt(layer.biasVelocity) + epsilon);
+		break;
+	}
+	default:
+		VectorAccelator::Axpy(learningRate, direction, layer.weights, count);
+		biasStep = learningRate * biasDirection;
+		break;
+	}
+
+	std::atomic_ref<float_n>(layer.bias).fetch_add(biasStep, std::memory_order_relaxed);
+}
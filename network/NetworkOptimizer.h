@@ -0,0 +1,42 @@
+#ifndef _NETWORK_OPTIMIZER_H_
+#define _NETWORK_OPTIMIZER_H_
+
+#include "NetworkStructure.h"
+
+namespace Network
+{
+	enum class OptimizerType
+	{
+		SGD,
+		Momentum,
+		Nesterov,
+		Adam
+	};
+
+	// Hyperparameters of the weight update, the learning rate stays with the network
+	struct OptimizerSettings
+	{
+		OptimizerType type = OptimizerType::SGD;
+
+		float_n momentum = 0.9f; // Momentum and Nesterov
+		float_n beta1 = 0.9f, beta2 = 0.999f, epsilon = 1e-8f; // Adam
+	};
+
+	namespace Optimizer
+	{
+		/// <summary>
+		/// Allocate zeroed state buffers of a layer for an optimizer, with the layout of the weights
+		/// SGD keeps no state, buffers of a previous optimizer are freed
+		/// </summary>
+		void ResetState(NeuronLayer& layer, OptimizerType type);
+
+		/// <summary>
+		/// One fused pass over the weights and state of a layer
+		/// direction is the descent direction with the layout of the weights, step counts from 1 and drives Adam's bias correction
+		/// Not synchronized, concurrent steps on a layer behave Hogwild-style
+		/// </summary>
+		void Step(OptimizerSettings& settings, long long step, float_n learningRate, NeuronLayer& layer, const float_n* direction, float_n biasDirection);
+	}
+}
+
+#endif
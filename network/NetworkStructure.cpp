@@ -1,22 +1,58 @@
 #include "NetworkStructure.h"
+#include "Deterministic.h"
 #include <random>
+#include <string.h>
+#include <stdlib.h>
 
 using namespace Network;
 
+float_n* Network::AlignedAlloc(size_t count)
+{
+	if (count == 0) return nullptr;
+
+	size_t size = (count * sizeof(float_n) + MemoryAlignment - 1) / MemoryAlignment * MemoryAlignment;
+
+#ifdef _MSC_VER
+	float_n* ptr = (float_n*)_aligned_malloc(size, MemoryAlignment);
+#else
+	float_n* ptr = (float_n*)aligned_alloc(MemoryAlignment, size);
+#endif
+
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void Network::AlignedFree(float_n* ptr)
+{
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
 Network::NeuronLayer::NeuronLayer(int neuronCount, int prevCount)
 {
 	this->neuronCount = neuronCount;
 	this->prevCount = prevCount;
 
-	value = new float_n[neuronCount];
-	error = new float_n[neuronCount];
-
-	ClearValues();
+	value = AlignedAlloc(neuronCount);
+	error = AlignedAlloc(neuronCount);
 
 	bias = 0.0;
 
-	for (int i = 0; i < neuronCount; i++)
-		weightList.push_back(new float_n[prevCount]);
+	// one contiguous matrix, padding columns stay zero
+	stride = AlignedStride(prevCount);
+	weights = AlignedAlloc((size_t)neuronCount * stride);
+
+	moment = nullptr;
+	velocity = nullptr;
+	biasMoment = biasVelocity = 0.0;
+
+	halfWeights = nullptr;
 }
 
 NeuronLayer::NeuronLayer()
@@ -25,28 +61,36 @@ NeuronLayer::NeuronLayer()
 	bias = 0.0;
 	prevCount = 0;
 	neuronCount = 0;
+	stride = 0;
 
+	weights = nullptr;
 	value = nullptr;
 	error = nullptr;
+
+	moment = nullptr;
+	velocity = nullptr;
+	biasMoment = biasVelocity = 0.0;
+
+	halfWeights = nullptr;
 }
 
 void NeuronLayer::InitAllWeights(float_n weight)
 {
 	for (int neuron = 0; neuron < neuronCount; neuron++)
 		for (int i = 0; i < prevCount; i++)
-			weightList[neuron][i] = weight;
+			(*this)[neuron][i] = weight;
 }
 
 void NeuronLayer::RandomizeWeightAndBias(float_n min, float_n max)
 {
-	std::mt19937 rnd(std::random_device{}());
+	std::mt19937 rnd = Deterministic::Engine(RandomStream::Init);
 	std::uniform_real_distribution<float_n> dist(min, max);
 
 	for (int neuron = 0; neuron < neuronCount; neuron++)
 	{
 		for (int i = 0; i < prevCount; i++)
 		{
-			weightList[neuron][i] = dist(rnd);
+			(*this)[neuron][i] = dist(rnd);
 		}
 	}
 
@@ -59,40 +103,28 @@ NeuronLayerInstance::NeuronLayerInstance(NeuronLayer* source)
 
 	prevCount = source->prevCount;
 	neuronCount = source->neuronCount;
+	stride = source->stride;
 	bias = source->bias;
 
-	value = new float_n[neuronCount];
-	error = new float_n[neuronCount];
-}
-
-void NeuronLayerInstance::FeedBack()
-{
-	for (int i = 0; i < neuronCount; i++)
-	{
-		source->value[i] += value[i];
-		source->error[i] += error[i];
-	}
+	value = AlignedAlloc(neuronCount);
+	error = AlignedAlloc(neuronCount);
 }
 
 void Network::NeuronLayerInstance::Free()
 {
-	delete[] value;
-	delete[] error;
-}
-
-void NeuronLayerInstance::ClearSourceValue()
-{
-	source->ClearValues();
+	AlignedFree(value);
+	AlignedFree(error);
 }
 
 void NeuronLayerInstance::FetchBias()
 {
-	bias = source->bias;
+	// asynchronous training may be adding to it
+	bias = std::atomic_ref<float_n>(source->bias).load(std::memory_order_relaxed);
 }
 
 float_n* Network::NeuronLayerInstance::operator[](int index)
 {
-	return source->weightList[index];
+	return (*source)[index];
 }
 
 void NeuronLayerInstance::PushDataFloat(float_n* data)
@@ -111,16 +143,86 @@ void NeuronLayer::ClearValues()
 
 float_n* Network::NeuronLayer::operator[](int index)
 {
-	return weightList[index];
+	return weights + (size_t)index * stride;
 }
 
 void Network::NeuronLayer::Free()
 {
-	for (auto neuron : weightList)
-		delete[] neuron;
+	AlignedFree(weights);
+	weights = nullptr;
+
+	AlignedFree(value);
+	AlignedFree(error);
+
+	AlignedFree(moment);
+	AlignedFree(velocity);
+	moment = velocity = nullptr;
+
+	AlignedFree((float_n*)halfWeights);
+	halfWeights = nullptr;
+}
+
+NeuronLayerBatch::NeuronLayerBatch(NeuronLayer* source, int batchSize)
+{
+	this->source = source;
+	this->batchSize = batchSize;
+
+	prevCount = source->prevCount;
+	neuronCount = source->neuronCount;
+	bias = source->bias;
+
+	valueStride = AlignedStride(neuronCount);
+	value = AlignedAlloc((size_t)batchSize * valueStride);
+	error = AlignedAlloc((size_t)batchSize * valueStride);
+
+	direction = nullptr;
+	biasDirection = 0.0;
+	scratch = nullptr;
+}
+
+void NeuronLayerBatch::Free()
+{
+	AlignedFree(value);
+	AlignedFree(error);
+	AlignedFree(direction);
+	AlignedFree(scratch);
+	direction = nullptr;
+	scratch = nullptr;
+}
+
+float_n* NeuronLayerBatch::Direction()
+{
+	// padding columns are never written and stay zero
+	if (direction == nullptr)
+		direction = AlignedAlloc((size_t)neuronCount * source->stride);
 
-	weightList.clear();
+	return direction;
+}
+
+float_n* NeuronLayerBatch::Scratch()
+{
+	if (scratch == nullptr)
+		scratch = AlignedAlloc(neuronCount);
+
+	return scratch;
+}
+
+void NeuronLayerBatch::FetchBias()
+{
+	bias = std::atomic_ref<float_n>(source->bias).load(std::memory_order_relaxed);
+}
 
-	delete[] value;
-	delete[] error;
+float_n* NeuronLayerBatch::operator[](int index)
+{
+	return (*source)[index];
+}
+
+float_n* NeuronLayerBatch::Sample(int index)
+{
+	return value + (size_t)index * valueStride;
+}
+
+float_n* NeuronLayerBatch::SampleError(int index)
+{
+	return error + (size_t)index * valueStride;
 }
@@ -8,10 +8,30 @@ namespace Network
 {
 	typedef float float_n;
 
+	// Alignment of weight matrices and value vectors, in bytes (one cache line)
+	const int MemoryAlignment = 64;
+
+	/// <summary>
+	/// Allocate a zero-filled, 64-byte aligned array of float_n
+	/// </summary>
+	float_n* AlignedAlloc(size_t count);
+	void AlignedFree(float_n* ptr);
+
+	/// <summary>
+	/// Round a row length up to a whole number of cache lines
+	/// </summary>
+	inline int AlignedStride(int count)
+	{
+		const int elements = MemoryAlignment / sizeof(float_n);
+		return (count + elements - 1) / elements * elements;
+	}
+
 	class NeuronLayer
 	{
 	public:
-		std::vector<float_n*> weightList;
+		float_n* weights; // row-major weight matrix, neuronCount rows of stride elements
+		int stride; // leading dimension of weights, padded to cache line
+
 		float_n* value;
 		float_n* error;
 		int neuronCount;
@@ -19,6 +39,13 @@ namespace Network
 
 		float_n bias;
 
+		// optimizer state, same layout as weights, null when the optimizer keeps none
+		float_n* moment;
+		float_n* velocity;
+		float_n biasMoment, biasVelocity;
+
+		unsigned short* halfWeights; // 16-bit copy of weights for mixed-precision transmission, same layout, null in full precision
+
 		NeuronLayer(int neuronCount, int prevCount);
 		NeuronLayer();
 
@@ -42,22 +69,54 @@ namespace Network
 
 		int prevCount;
 		int neuronCount;
+		int stride; // leading dimension of source weights
 
 		float_n bias;
 
 		NeuronLayerInstance(NeuronLayer* source);
-		NeuronLayerInstance() :value(nullptr), source(nullptr), error(nullptr), prevCount(0), neuronCount(0), bias(0) {}
-
-		void FeedBack();
+		NeuronLayerInstance() :value(nullptr), source(nullptr), error(nullptr), prevCount(0), neuronCount(0), stride(0), bias(0) {}
 
 		void Free();
-		void ClearSourceValue();
 		void FetchBias();
 
 		float_n* operator[](int index);
 
 		void PushDataFloat(float_n* data);
 	};
+
+	// Used for batched transmission, holds activations of up to batchSize samples
+	// value and error are row-major matrices, one row of valueStride elements per sample
+	class NeuronLayerBatch
+	{
+	public:
+		NeuronLayer* source;
+
+		float_n* value;
+		float_n* error;
+
+		int prevCount;
+		int neuronCount;
+		int batchSize;
+		int valueStride; // leading dimension of value and error
+
+		float_n* direction; // weight update summed over a batch, layout of source weights, allocated on first use
+		float_n biasDirection; // bias update summed over a batch, set along with direction by FullConnNetwork::ComputeDirections
+		float_n* scratch; // one row of neuronCount elements for ComputeDirections, allocated on first use
+
+		float_n bias;
+
+		NeuronLayerBatch(NeuronLayer* source, int batchSize);
+		NeuronLayerBatch() :value(nullptr), source(nullptr), error(nullptr), prevCount(0), neuronCount(0), batchSize(0), valueStride(0), direction(nullptr), biasDirection(0), scratch(nullptr), bias(0) {}
+
+		void Free();
+		void FetchBias();
+
+		float_n* operator[](int index); // weights of a neuron
+		float_n* Sample(int index); // values of a sample
+		float_n* SampleError(int index); // errors of a sample
+		float_n* Direction();
+		float_n* Scratch();
+	};
 }
 
 #endif
\ No newline at end of file
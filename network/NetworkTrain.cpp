@@ -1,338 +1,555 @@
-//#include "NetworkFramework.h"
-//
-//#include <mutex>
-//
-//namespace Network::Connectivity
-//{
-//	void TrainWork(FullConnNetwork* network, NetworkDataSet* dataset, std::atomic<int>* currentTask, std::atomic<int>* completeTask, std::atomic<int>* maxTask, std::mutex *mutexLock)
-//	{
-//		std::cout << "[Train] Thread Started. Id: " << std::this_thread::get_id() << std::endl;
-//
-//		std::unique_ptr<float_n> target(new float_n[network->outNeuronCount]);
-//
-//		// create temporary instances
-//		NeuronLayerInstance inLayer(&network->inLayer);
-//		NeuronLayerInstance outLayer(&network->outLayer);
-//
-//		std::vector<NeuronLayerInstance> hiddenLayers; // hidden layer list
-//		for (auto& layer : network->hiddenLayerList)
-//			hiddenLayers.push_back(NeuronLayerInstance(&layer));
-//
-//		// main loop
-//		while (1)
-//		{
-//			if (*maxTask < 0) // minus for quitting
-//			{
-//				break;
-//			}
-//			if (*currentTask < *maxTask) // some work waiting to quit
-//			{
-//				// occupy a task
-//				int task = *currentTask;
-//				(*currentTask)++;
-//
-//				if (task >= dataset->Count()) break;
-//
-//				// fetch bias
-//				for (auto& layer : hiddenLayers)
-//				{
-//					layer.FetchBias();
-//				}
-//				outLayer.FetchBias();
-//
-//				const int count = hiddenLayers.size();
-//
-//				// Push Data (Note: Don't use PushDataFloat() in network class, use the instance class one)
-//				inLayer.PushDataFloat((*dataset)[task].data);
-//				// get label
-//				int label = (*dataset)[task].label;
-//				for (int i = 0; i < network->outNeuronCount; i++)
-//				{
-//					target.get()[i] = i == label ? 1.0 : 0.0;
-//				}
-//
-//				// forward
-//				for (int i = 0; i < count; i++)
-//				{
-//					network->ForwardTransmitLayer(hiddenLayers[i], i == 0 ? inLayer : hiddenLayers[i - 1]);
-//				}
-//
-//				NeuronLayerInstance& lastHiddenLayer = hiddenLayers[count - 1];
-//
-//				for (int i = 0; i < outLayer.Count(); i++)
-//				{
-//					outLayer[i].value = 0.0;
-//
-//					for (int j = 0; j < outLayer.prevCount; j++)
-//					{
-//						outLayer[i].value += lastHiddenLayer[j].value * outLayer[i].weights[j];
-//					}
-//
-//					outLayer[i].value += outLayer.bias;
-//					outLayer[i].value = outLayer[i].value / (float_n)outLayer.prevCount;
-//				}
-//
-//				// softmax layer
-//				if (network->outLayerSoftMax)
-//				{
-//					Network::Algorithm::SoftMax(outLayer);
-//					Network::Algorithm::SoftMaxGetError(outLayer, target.get());
-//				}
-//				else // no softmax
-//				{
-//					for (int i = 0; i < outLayer.Count(); i++)
-//					{
-//						outLayer[i].value = (*network->BackwardActive)(target.get()[i] - outLayer[i].value);
-//					}
-//				}
-//
-//				// backward transmit
-//				for (int i = count - 1; i >= 0; i--)
-//				{
-//					network->BackwardTransmitLayer(hiddenLayers[i], i == count - 1 ? outLayer : hiddenLayers[i + 1]);
-//				}
-//
-//				// Feedback to source
-//				//mutexLock->lock(); // lock network source
-//
-//				for (auto& layer : hiddenLayers)
-//					layer.FeedBack();
-//
-//				inLayer.FeedBack();
-//				outLayer.FeedBack();
-//
-//				//mutexLock->unlock(); // unlock network source
-//				(*completeTask)++;
-//			}
-//			else
-//			{
-//				std::this_thread::sleep_for(std::chrono::microseconds(100));
-//			}
-//		}
-//
-//		// clear up temporary instances
-//		inLayer.Destroy();
-//		outLayer.Destroy();
-//		for (auto& layer : hiddenLayers)
-//			layer.Destroy();
-//		hiddenLayers.clear();
-//
-//		std::cout << "[Train] Thread Terminated. Id: " << std::this_thread::get_id() << std::endl;
-//
-//		return;
-//	}
-//
-//	void TrainWorkImage(FullConnNetwork* network, std::vector<ImageDataset*>* dataset, std::atomic<int>* currentTask, std::atomic<int>* completeTask, std::atomic<int>* maxTask, std::mutex* mutexLock)
-//	{
-//		std::cout << "[Train] Thread Started. Id: " << std::this_thread::get_id() << std::endl;
-//
-//		std::unique_ptr<float_n> target(new float_n[network->outNeuronCount]);
-//
-//		// create temporary instances
-//		NeuronLayerInstance inLayer(&network->inLayer);
-//		NeuronLayerInstance outLayer(&network->outLayer);
-//
-//		std::vector<NeuronLayerInstance> hiddenLayers; // hidden layer list
-//		for (auto& layer : network->hiddenLayerList)
-//			hiddenLayers.push_back(NeuronLayerInstance(&layer));
-//
-//		// main loop
-//		while (1)
-//		{
-//			if (*maxTask < 0) // minus for quitting
-//			{
-//				break;
-//			}
-//			if (*currentTask < *maxTask) // some work waiting to quit
-//			{
-//				// occupy a task
-//				int task = *currentTask;
-//				(*currentTask)++;
-//
-//				if (task >= dataset->size()) break;
-//
-//				// fetch bias
-//				for (auto& layer : hiddenLayers)
-//				{
-//					layer.FetchBias();
-//				}
-//				outLayer.FetchBias();
-//
-//				const int count = hiddenLayers.size();
-//
-//				// Push Data (Note: Don't use PushDataFloat() in network class, use the instance class one)
-//				inLayer.PushDataFloat((*dataset)[task]->sdData);
-//				
-//				for (int i = 0; i < (*dataset)[task]->size * 4; i++)
-//					target.get()[i] = (*dataset)[task]->hdData[i];
-//
-//				// forward
-//				for (int i = 0; i < count; i++)
-//				{
-//					network->ForwardTransmitLayer(hiddenLayers[i], i == 0 ? inLayer : hiddenLayers[i - 1]);
-//				}
-//
-//				NeuronLayerInstance& lastHiddenLayer = hiddenLayers[count - 1];
-//
-//				for (int i = 0; i < outLayer.Count(); i++)
-//				{
-//					outLayer[i].value = 0.0;
-//
-//					for (int j = 0; j < outLayer.prevCount; j++)
-//					{
-//						outLayer[i].value += lastHiddenLayer[j].value * outLayer[i].weights[j];
-//					}
-//
-//					outLayer[i].value += outLayer.bias;
-//					outLayer[i].value = outLayer[i].value / (float_n)outLayer.prevCount;
-//				}
-//
-//				// softmax layer
-//				if (network->outLayerSoftMax)
-//				{
-//					Network::Algorithm::SoftMax(outLayer);
-//					Network::Algorithm::SoftMaxGetError(outLayer, target.get());
-//				}
-//				else // no softmax
-//				{
-//					for (int i = 0; i < outLayer.Count(); i++)
-//					{
-//						outLayer[i].value = (*network->BackwardActive)(target.get()[i] - outLayer[i].value);
-//					}
-//				}
-//
-//				// backward transmit
-//				for (int i = count - 1; i >= 0; i--)
-//				{
-//					network->BackwardTransmitLayer(hiddenLayers[i], i == count - 1 ? outLayer : hiddenLayers[i + 1]);
-//				}
-//
-//				// Feedback to source
-//				//mutexLock->lock(); // lock network source
-//
-//				for (auto& layer : hiddenLayers)
-//					layer.FeedBack();
-//
-//				inLayer.FeedBack();
-//				outLayer.FeedBack();
-//
-//				//mutexLock->unlock(); // unlock network source
-//				(*completeTask)++;
-//			}
-//		}
-//
-//		// clear up temporary instances
-//		inLayer.Destroy();
-//		outLayer.Destroy();
-//		for (auto& layer : hiddenLayers)
-//			layer.Destroy();
-//		hiddenLayers.clear();
-//
-//		std::cout << "[Train] Thread Terminated. Id: " << std::this_thread::get_id() << std::endl;
-//
-//		return;
-//	}
-//
-//	void FullConnNetwork::TrainBatched(NetworkDataSet& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback)
-//	{
-//		std::cout << std::format("[Train] Train Started. Parameters: batchSize={}, learningRate={}", batchSize, learningRate) << std::endl;
-//
-//		std::atomic<int> currentTask = 0, completedTask = 0, maxTask = 0;
-//		std::mutex mainNetworkLock;
-//		size_t count = dataset.Count();
-//
-//		std::vector<std::thread> threadList;
-//
-//		this->learningRate = learningRate;
-//
-//		// if batchSize is larger than hardware concurrency, use hardware concurrency
-//		int taskCount = batchSize > std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : batchSize;
-//
-//		for (int i = 0; i < taskCount; i++)
-//		{
-//			threadList.push_back(std::thread(TrainWork, this, &dataset, &currentTask, &completedTask, &maxTask, &mainNetworkLock));
-//		}
-//
-//		// compute
-//		while (count - maxTask >= batchSize)
-//		{
-//
-//			maxTask += batchSize;
-//
-//			while (completedTask < maxTask);
-//
-//			//mainNetworkLock.lock(); // lock main network
-//
-//			computeAverage(batchSize); // do average
-//			UpdateWeights();
-//
-//			// clear values
-//			inLayer.ClearValues();
-//			outLayer.ClearValues();
-//			for (auto& layer : hiddenLayerList)
-//				layer.ClearValues();
-//
-//			//mainNetworkLock.unlock(); // unlock main network
-//
-//			callback(completedTask, count); // progress callback
-//		}
-//
-//		// send terminate signal
-//		maxTask = -1;
-//
-//		for (auto& thread : threadList) thread.join();
-//		threadList.clear();
-//	}
-//
-//	void FullConnNetwork::TrainBatched(std::vector<ImageDataset*>& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback)
-//	{
-//		std::cout << std::format("[Train] Train Started. Parameters: batchSize={}, learningRate={}", batchSize, learningRate) << std::endl;
-//
-//		std::atomic<int> currentTask = 0, completedTask = 0, maxTask = 0;
-//		std::mutex mainNetworkLock;
-//		size_t count = dataset.size();
-//
-//		std::vector<std::thread> threadList;
-//
-//		this->learningRate = learningRate;
-//
-//		// if batchSize is larger than hardware concurrency, use hardware concurrency
-//		int taskCount = batchSize > std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : batchSize;
-//
-//		for (int i = 0; i < taskCount; i++)
-//		{
-//			threadList.push_back(std::thread(TrainWorkImage, this, &dataset, &currentTask, &completedTask, &maxTask, &mainNetworkLock));
-//		}
-//
-//		// compute
-//		while (count - maxTask >= batchSize)
-//		{
-//			maxTask += batchSize;
-//
-//			while (completedTask < maxTask) std::this_thread::sleep_for(std::chrono::milliseconds(1));
-//
-//			//mainNetworkLock.lock(); // lock main network
-//
-//			computeAverage(batchSize); // do average
-//			UpdateWeights();
-//
-//			// clear values
-//			inLayer.ClearValues();
-//			outLayer.ClearValues();
-//			for (auto& layer : hiddenLayerList)
-//				layer.ClearValues();
-//
-//			//mainNetworkLock.unlock(); // unlock main network
-//
-//			callback(completedTask, count); // progress callback
-//			std::cerr << "Completed: " << maxTask << std::endl;
-//		}
-//
-//		// send terminate signal
-//		maxTask = -1;
-//
-//		for (auto& thread : threadList) thread.join();
-//		threadList.clear();
-//	}
-//	
-//}
\ No newline at end of file
+#include "NetworkFramework.h"
+#include "WorkerPool.h"
+#include "MatrixAccelator.h"
+#include "Deterministic.h"
+#include "RingAllReduce.h"
+#include "BatchLoader.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace Network;
+using namespace Network::Connectivity;
+
+// Chunks per worker within a sync interval, leaves room for stealing when workers differ in speed
+static const int ChunksPerWorker = 4;
+
+// Minibatches TrainBatched assembles ahead of the one training, and the threads assembling them
+// Two loaders keep up with the pool even when samples are cut from planes
+static const int PrefetchBatches = 4;
+static const int LoaderThreads = 2;
+
+// One Hogwild step of a worker over the samples pushed into its batch
+// Returns the summed loss of the samples, taken from the forward pass the step needs anyway
+static double AsyncStep(FullConnNetworkBatch& batch, int count)
+{
+	batch.FetchBias();
+	batch.ForwardTransmit(count);
+
+	double loss = batch.GetLoss(count);
+
+	batch.BackwardTransmit(count);
+	batch.ComputeDirections(count);
+	batch.ApplyDirectionsRelaxed(count);
+
+	return loss;
+}
+
+// Points a batch at rows held elsewhere, its own matrices are swapped back on leaving the scope
+struct BorrowedRows
+{
+	FullConnNetworkBatch& batch;
+	float_n* input;
+	float_n* target;
+
+	BorrowedRows(FullConnNetworkBatch& batch, float_n* input, float_n* target) :batch(batch), input(input), target(target)
+	{
+		batch.SwapData(this->input, this->target);
+	}
+
+	~BorrowedRows()
+	{
+		batch.SwapData(input, target);
+	}
+};
+
+static void FreeBatches(std::vector<FullConnNetworkBatch*>& batches)
+{
+	for (auto& item : batches)
+	{
+		item->FreeData();
+		delete item;
+	}
+
+	batches.clear();
+}
+
+// Sums the slot directions into slot 0 with a pairwise tree, slot i takes in slot i + stride, pairs of a level run in parallel
+// The order of additions only depends on the number of slots, so results are reproducible
+static void ReduceDirections(WorkerPool& pool, std::vector<FullConnNetworkBatch*>& batches, int used)
+{
+	for (int stride = 1; stride < used; stride *= 2)
+	{
+		int pairs = (used - stride + 2 * stride - 1) / (2 * stride);
+
+		pool.Run(pairs, 1, [&](int worker, int begin, int end)
+		{
+			for (int pair = begin; pair < end; pair++)
+				batches[pair * 2 * stride]->AddDirections(*batches[pair * 2 * stride + stride]);
+		});
+	}
+}
+
+// Every minibatch is split into one slot per pool worker: each slot transmits its samples and sums their directions
+// into buffers of its own, the sums meet in ReduceDirections and are applied as one step
+// Nothing shared is written while the slots run, so they need no locks. Slots are handed out one at a time,
+// a worker done with its own steals the slots of a slower one, and the pool returning is the barrier of the minibatch
+// fetch(index, input, target) writes data and target of a sample into two rows, run on the loader threads
+template<typename Fetch>
+static double TrainBatchedImpl(FullConnNetwork* network, int count, int batchSize, std::function<void(int, int)>& callback, Fetch fetch)
+{
+	if (batchSize <= 0)
+		throw std::exception("Invalid Parameters");
+
+	WorkerPool pool;
+	const int slots = std::min(pool.Count(), batchSize);
+	const int share = (batchSize + slots - 1) / slots; // samples per slot
+
+	std::vector<FullConnNetworkBatch*> batches;
+	std::vector<double> losses(slots, 0.0); // loss of each slot in the current minibatch
+
+	double loss = 0.0;
+	int done = 0;
+
+	try
+	{
+		for (int i = 0; i < slots; i++)
+			batches.push_back(new FullConnNetworkBatch(network, share));
+
+		BatchLoader loader(network, batchSize, count, fetch, PrefetchBatches, LoaderThreads);
+
+		while (int size = loader.Next())
+		{
+			int used = (size + share - 1) / share; // slots with samples in this minibatch
+
+			pool.Run(used, 1, [&](int worker, int begin, int end)
+			{
+				bool serial = MatrixAccelator::SetThreadSerial(true); // the pool already occupies every core
+
+				for (int slot = begin; slot < end; slot++)
+				{
+					auto& batch = *batches[slot];
+					int offset = slot * share;
+					int filled = std::min(share, size - offset);
+
+					BorrowedRows rows(batch, loader.GetInput(offset), loader.GetTarget(offset));
+
+					batch.FetchBias();
+					batch.ForwardTransmit(filled);
+					losses[slot] = batch.GetLoss(filled);
+					batch.BackwardTransmit(filled);
+					batch.ComputeDirections(filled);
+				}
+
+				MatrixAccelator::SetThreadSerial(serial);
+			});
+
+			ReduceDirections(pool, batches, used);
+			batches[0]->ApplyDirections(size);
+
+			for (int slot = 0; slot < used; slot++)
+				loss += losses[slot];
+
+			done += size;
+
+			callback(done, count); // progress callback
+		}
+
+		network->loaderStall = loader.StallTime();
+	}
+	catch (...)
+	{
+		FreeBatches(batches);
+		throw;
+	}
+
+	FreeBatches(batches);
+
+	return count > 0 ? loss / count : 0.0;
+}
+
+// Deterministic stand-in for async: every round each slot sums the directions of localBatch samples against the same weights,
+// slot sums meet in a fixed pairwise tree and are applied as one step
+// Slot i always takes the same samples whichever worker runs it, so results only depend on the number of slots
+template<typename Fetch>
+static double TrainLockstepImpl(FullConnNetwork* network, int count, int localBatch, int syncInterval, std::function<void(int, int)>& callback, Fetch fetch)
+{
+	WorkerPool pool;
+	const int slots = pool.Count();
+
+	std::vector<FullConnNetworkBatch*> batches;
+	std::vector<double> losses(slots, 0.0); // loss of each slot in the current round
+
+	double loss = 0.0;
+
+	try
+	{
+		for (int i = 0; i < slots; i++)
+			batches.push_back(new FullConnNetworkBatch(network, localBatch));
+
+		for (int first = 0; first < count; first += syncInterval)
+		{
+			int size = std::min(syncInterval, count - first);
+
+			for (int round = first; round < first + size; round += slots * localBatch)
+			{
+				int roundEnd = std::min(round + slots * localBatch, first + size);
+				int used = (roundEnd - round + localBatch - 1) / localBatch; // slots with samples in this round
+
+				pool.Run(used, 1, [&](int worker, int begin, int end)
+				{
+					bool serial = MatrixAccelator::SetThreadSerial(true); // the pool already occupies every core
+
+					for (int slot = begin; slot < end; slot++)
+					{
+						auto& batch = *batches[slot];
+						int offset = round + slot * localBatch;
+						int filled = std::min(localBatch, roundEnd - offset);
+
+						for (int i = 0; i < filled; i++)
+							fetch(offset + i, batch.GetInput(i), batch.GetTarget(i));
+
+						batch.FetchBias();
+						batch.ForwardTransmit(filled);
+						losses[slot] = batch.GetLoss(filled);
+						batch.BackwardTransmit(filled);
+						batch.ComputeDirections(filled);
+					}
+
+					MatrixAccelator::SetThreadSerial(serial);
+				});
+
+				ReduceDirections(pool, batches, used);
+				batches[0]->ApplyDirections(roundEnd - round);
+
+				for (int slot = 0; slot < used; slot++)
+					loss += losses[slot];
+			}
+
+			callback(first + size, count); // progress callback
+		}
+	}
+	catch (...)
+	{
+		FreeBatches(batches);
+		throw;
+	}
+
+	FreeBatches(batches);
+
+	return count > 0 ? loss / count : 0.0;
+}
+
+// Async: no barrier per batch, every worker takes a step of its own every localBatch samples
+// Workers only meet every syncInterval samples, where leftover samples are stepped and progress is reported
+template<typename Fetch>
+static double TrainAsyncImpl(FullConnNetwork* network, int count, int localBatch, int syncInterval, std::function<void(int, int)>& callback, Fetch fetch)
+{
+	if (localBatch <= 0 || syncInterval <= 0)
+		throw std::exception("Invalid Parameters");
+
+	if (Deterministic::Enabled())
+		return TrainLockstepImpl(network, count, localBatch, syncInterval, callback, fetch);
+
+	// optimizer state would be stepped by every worker at once
+	if (network->optimizer.type != OptimizerType::SGD)
+		throw std::exception("Optimizer Not Supported!");
+
+	// every worker would narrow whole layers after each of its steps
+	if (network->mixedPrecision)
+		throw std::exception("Mixed Precision Not Supported!");
+
+	WorkerPool pool;
+
+	std::vector<FullConnNetworkBatch*> batches;
+	std::vector<int> filled(pool.Count(), 0); // samples waiting in each worker's batch
+	std::vector<double> losses(pool.Count(), 0.0); // running loss of each worker
+
+	try
+	{
+		for (int i = 0; i < pool.Count(); i++)
+			batches.push_back(new FullConnNetworkBatch(network, localBatch));
+
+		for (int first = 0; first < count; first += syncInterval)
+		{
+			int size = std::min(syncInterval, count - first);
+
+			pool.Run(size, std::max(localBatch, size / (pool.Count() * ChunksPerWorker)), [&](int worker, int begin, int end)
+			{
+				auto& batch = *batches[worker];
+				bool serial = MatrixAccelator::SetThreadSerial(true); // the pool already occupies every core
+
+				for (int i = begin; i < end; i++)
+				{
+					fetch(first + i, batch.GetInput(filled[worker]), batch.GetTarget(filled[worker]));
+					filled[worker]++;
+
+					if (filled[worker] == localBatch)
+					{
+						losses[worker] += AsyncStep(batch, localBatch);
+						filled[worker] = 0;
+					}
+				}
+
+				MatrixAccelator::SetThreadSerial(serial);
+			});
+
+			for (int i = 0; i < pool.Count(); i++)
+			{
+				if (filled[i] > 0)
+					losses[i] += AsyncStep(*batches[i], filled[i]);
+
+				filled[i] = 0;
+			}
+
+			callback(first + size, count); // progress callback
+		}
+	}
+	catch (...)
+	{
+		FreeBatches(batches);
+		throw;
+	}
+
+	FreeBatches(batches);
+
+	double loss = 0.0;
+	for (auto& item : losses)
+		loss += item;
+
+	return count > 0 ? loss / count : 0.0;
+}
+
+// Labelled sample, one-hot target
+struct LabelledSample
+{
+	NetworkDataSet& dataset;
+	int inCount, outCount;
+
+	void operator()(int index, float_n* input, float_n* target)
+	{
+		memcpy(input, dataset[index].data, sizeof(float_n) * inCount);
+
+		int label = dataset[index].label;
+		for (int i = 0; i < outCount; i++)
+			target[i] = i == label ? 1.0 : 0.0;
+	}
+};
+
+// Patch of a store in training order, the HD patch is the target
+struct PatchSample
+{
+	PatchStore& dataset;
+	int inCount, outCount;
+
+	void operator()(int index, float_n* input, float_n* target)
+	{
+		int id = dataset.order[index];
+
+		memcpy(input, dataset.Sd(id), sizeof(float_n) * inCount);
+		memcpy(target, dataset.Hd(id), sizeof(float_n) * outCount);
+	}
+};
+
+// Patch of a source's current epoch, cut from its plane straight into the rows
+struct LazySample
+{
+	PatchSource& dataset;
+
+	void operator()(int index, float_n* input, float_n* target)
+	{
+		dataset.Cut(index, input, target);
+	}
+};
+
+// Cut patches fill whole input and target rows
+static void CheckSource(FullConnNetwork* network, PatchSource& dataset)
+{
+	int size = dataset.coreSize * dataset.coreSize;
+
+	if (network->inNeuronCount != size || network->outNeuronCount != size)
+		throw std::exception("Size Mismatch!");
+
+	if (dataset.Images() == 0 && dataset.count > 0)
+		throw std::exception("Invalid Parameters");
+}
+
+double FullConnNetwork::TrainBatched(NetworkDataSet& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback)
+{
+	this->learningRate = learningRate;
+	return TrainBatchedImpl(this, dataset.Count(), batchSize, callback, LabelledSample{ dataset, inNeuronCount, outNeuronCount });
+}
+
+double FullConnNetwork::TrainBatched(PatchStore& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback)
+{
+	this->learningRate = learningRate;
+	return TrainBatchedImpl(this, dataset.order.size(), batchSize, callback, PatchSample{ dataset, inNeuronCount, outNeuronCount });
+}
+
+double FullConnNetwork::TrainBatched(PatchSource& dataset, int batchSize, float_n learningRate, std::function<void(int, int)> callback)
+{
+	CheckSource(this, dataset);
+
+	this->learningRate = learningRate;
+	return TrainBatchedImpl(this, dataset.count, batchSize, callback, LazySample{ dataset });
+}
+
+double FullConnNetwork::TrainAsync(NetworkDataSet& dataset, int localBatch, int syncInterval, float_n learningRate, std::function<void(int, int)> callback)
+{
+	this->learningRate = learningRate;
+	return TrainAsyncImpl(this, dataset.Count(), localBatch, syncInterval, callback, LabelledSample{ dataset, inNeuronCount, outNeuronCount });
+}
+
+double FullConnNetwork::TrainAsync(PatchStore& dataset, int localBatch, int syncInterval, float_n learningRate, std::function<void(int, int)> callback)
+{
+	this->learningRate = learningRate;
+	return TrainAsyncImpl(this, dataset.order.size(), localBatch, syncInterval, callback, PatchSample{ dataset, inNeuronCount, outNeuronCount });
+}
+
+double FullConnNetwork::TrainAsync(PatchSource& dataset, int localBatch, int syncInterval, float_n learningRate, std::function<void(int, int)> callback)
+{
+	CheckSource(this, dataset);
+
+	this->learningRate = learningRate;
+	return TrainAsyncImpl(this, dataset.count, localBatch, syncInterval, callback, LazySample{ dataset });
+}
+
+// Sums of the ring only line up when every rank has the same layers, optimizer and batch size
+static void CheckRing(FullConnNetwork* network, int batchSize, RingAllReduce& ring)
+{
+	std::vector<double> own = { (double)network->inNeuronCount, (double)network->outNeuronCount, (double)network->hiddenNeuronCount,
+		(double)network->hiddenLayerCount, (double)(int)network->optimizer.type, (double)batchSize };
+	std::vector<double> sum = own;
+
+	ring.Submit(sum.data(), sum.size());
+	ring.Wait();
+
+	for (int i = 0; i < own.size(); i++)
+		if (sum[i] != own[i] * ring.WorldSize())
+			throw std::exception("Ring Mismatch!");
+}
+
+// Weights and optimizer state of rank 0 on every rank
+static void BroadcastState(FullConnNetwork* network, RingAllReduce& ring)
+{
+	auto broadcast = [&](NeuronLayer& layer)
+	{
+		size_t count = (size_t)layer.neuronCount * layer.stride;
+
+		ring.Broadcast(layer.weights, count, 0);
+		if (layer.moment) ring.Broadcast(layer.moment, count, 0);
+		if (layer.velocity) ring.Broadcast(layer.velocity, count, 0);
+
+		float_n state[] = { layer.bias, layer.biasMoment, layer.biasVelocity };
+		ring.Broadcast(state, 3, 0);
+		layer.bias = state[0];
+		layer.biasMoment = state[1];
+		layer.biasVelocity = state[2];
+
+		network->RefreshHalfWeights(layer);
+	};
+
+	broadcast(network->outLayer);
+	for (auto& layer : network->hiddenLayerList)
+		broadcast(layer);
+
+	double step = (double)network->optimizerStep;
+	ring.Broadcast(&step, 1, 0);
+	network->optimizerStep = (long long)step;
+}
+
+double FullConnNetwork::TrainDistributed(PatchStore& shard, int batchSize, float_n learningRate, RingAllReduce& ring, std::function<void(int, int)> callback)
+{
+	if (batchSize <= 0)
+		throw std::exception("Invalid Parameters");
+
+	this->learningRate = learningRate;
+
+	CheckRing(this, batchSize, ring);
+	BroadcastState(this, ring);
+
+	// the longest shard sets the number of steps, ranks that ran out take part with empty batches
+	std::vector<double> sizes(ring.WorldSize(), 0.0);
+	sizes[ring.Rank()] = (double)shard.order.size();
+	ring.Submit(sizes.data(), sizes.size());
+	ring.Wait();
+
+	int count = shard.order.size();
+	int steps = ((int)*std::max_element(sizes.begin(), sizes.end()) + batchSize - 1) / batchSize;
+
+	FullConnNetworkBatch batch(this, batchSize);
+	PatchSample fetch{ shard, inNeuronCount, outNeuronCount };
+
+	std::vector<float_n> meta(hiddenLayerList.size() + 2); // bias directions of every layer, then the samples of the step
+	double loss = 0.0;
+
+	auto submit = [&](NeuronLayerBatch& layer)
+	{
+		ring.Submit(layer.Direction(), (size_t)layer.neuronCount * layer.source->stride);
+	};
+
+	try
+	{
+		for (int step = 0; step < steps; step++)
+		{
+			int first = step * batchSize;
+			int size = std::max(0, std::min(batchSize, count - first));
+
+			if (size > 0)
+			{
+				for (int i = 0; i < size; i++)
+					fetch(first + i, batch.GetInput(i), batch.GetTarget(i));
+
+				batch.FetchBias();
+				batch.ForwardTransmit(size);
+				loss += batch.GetLoss(size);
+
+				// a layer's sum travels the ring while the layers below it are transmitted back
+				batch.BackwardDirections(size, submit);
+			}
+			else
+			{
+				// same sequence of sums as BackwardDirections, adding nothing
+				auto empty = [&](NeuronLayerBatch& layer)
+				{
+					memset(layer.Direction(), 0, sizeof(float_n) * layer.neuronCount * layer.source->stride);
+					layer.biasDirection = 0.0;
+					submit(layer);
+				};
+
+				empty(batch.outLayer);
+				for (int i = batch.hiddenLayerList.size() - 1; i >= 0; i--)
+					empty(batch.hiddenLayerList[i]);
+			}
+
+			meta[0] = batch.outLayer.biasDirection;
+			for (int i = 0; i < batch.hiddenLayerList.size(); i++)
+				meta[i + 1] = batch.hiddenLayerList[i].biasDirection;
+			meta.back() = (float_n)size;
+
+			ring.Submit(meta.data(), meta.size());
+			ring.Wait();
+
+			batch.outLayer.biasDirection = meta[0];
+			for (int i = 0; i < batch.hiddenLayerList.size(); i++)
+				batch.hiddenLayerList[i].biasDirection = meta[i + 1];
+
+			// every rank holds the same sums, so every rank takes the same step
+			batch.ApplyDirections((int)meta.back());
+
+			callback(std::min(first + batchSize, count), count); // progress callback
+		}
+	}
+	catch (...)
+	{
+		// sums still in flight write into the batch, the original error is the one worth reporting
+		try
+		{
+			ring.Wait();
+		}
+		catch (...)
+		{
+		}
+
+		batch.FreeData();
+		throw;
+	}
+
+	batch.FreeData();
+
+	double totals[] = { loss, (double)count };
+	ring.Submit(totals, 2);
+	ring.Wait();
+
+	return totals[1] > 0 ? totals[0] / totals[1] : 0.0;
+}
@@ -0,0 +1,237 @@
+#include "QuantizedNetwork.h"
+#include "MatrixAccelator.h"
+#include "VectorAccelator.h"
+
+#include <math.h>
+#include <string.h>
+#include <float.h>
+#include <algorithm>
+
+using namespace Network;
+using namespace Network::Connectivity;
+using namespace Network::Algorithm;
+
+// Samples transmitted at once while calibrating
+static const int CalibrationBatchSize = 256;
+
+Network::QuantizedLayer::QuantizedLayer(NeuronLayer& layer, float_n inputMin, float_n inputMax)
+{
+	prevCount = layer.prevCount;
+	neuronCount = layer.neuronCount;
+
+	// zero must be representable, padded inputs are quantized from it
+	inputMin = std::min(inputMin, 0.0f);
+	inputMax = std::max(inputMax, 0.0f);
+
+	inputScale = inputMax - inputMin > FLT_EPSILON ? (inputMax - inputMin) / QuantizedInputMax : 1.0f / QuantizedInputMax;
+	inputZero = std::clamp((int)lrintf(-inputMin / inputScale), 0, QuantizedInputMax);
+
+	std::vector<signed char> rows((size_t)neuronCount * prevCount);
+
+	outputScale = new float_n[neuronCount];
+	outputShift = new float_n[neuronCount];
+
+	for (int row = 0; row < neuronCount; row++)
+	{
+		const float_n* src = layer[row];
+		signed char* dst = &rows[(size_t)row * prevCount];
+
+		float_n maxAbs = 0.0f;
+		for (int i = 0; i < prevCount; i++)
+			maxAbs = std::max(maxAbs, fabsf(src[i]));
+
+		float_n weightScale = maxAbs > 0.0f ? maxAbs / QuantizedWeightMax : 1.0f;
+		int rowSum = 0;
+
+		for (int i = 0; i < prevCount; i++)
+		{
+			int q = std::clamp((int)lrintf(src[i] / weightScale), -QuantizedWeightMax, QuantizedWeightMax);
+			dst[i] = (signed char)q;
+			rowSum += q;
+		}
+
+		// (weightScale * inputScale * (sum - inputZero * rowSum) + bias) / prevCount
+		float_n scale = weightScale * inputScale / (float_n)prevCount;
+		outputScale[row] = scale;
+		outputShift[row] = layer.bias / (float_n)prevCount - scale * (float_n)inputZero * (float_n)rowSum;
+	}
+
+	size_t size = MatrixAccelator::PackedSizeU8S8(neuronCount, prevCount);
+	weights = (signed char*)AlignedAlloc((size + sizeof(float_n) - 1) / sizeof(float_n));
+	MatrixAccelator::PackU8S8(neuronCount, prevCount, rows.data(), prevCount, weights);
+}
+
+void Network::QuantizedLayer::QuantizeInput(const float_n* x, unsigned char* q)
+{
+	VectorAccelator::QuantizeU7(x, 1.0f / inputScale, (float_n)inputZero, q, prevCount);
+
+	// products are taken over groups of 4 columns, padding meets zero weights
+	for (int i = prevCount; i % 4 != 0; i++)
+		q[i] = 0;
+}
+
+void Network::QuantizedLayer::Dequantize(const int* sum, float_n* out)
+{
+	VectorAccelator::Dequantize(sum, outputScale, outputShift, out, neuronCount);
+}
+
+void Network::QuantizedLayer::Free()
+{
+	AlignedFree((float_n*)weights);
+	weights = nullptr;
+
+	delete[] outputScale;
+	delete[] outputShift;
+	outputScale = nullptr;
+	outputShift = nullptr;
+}
+
+QuantizedNetwork::QuantizedNetwork(FullConnNetwork* network, std::vector<float_n*>& samples)
+{
+	if (samples.empty())
+		throw std::exception("No Calibration Data!");
+
+	if (network->outLayerSoftMax)
+		throw std::exception("SoftMax Not Supported!");
+
+	ActivateFunc = network->ActivateFunc;
+	inNeuronCount = network->inNeuronCount;
+	outNeuronCount = network->outNeuronCount;
+
+	// ranges[i]: inputs of hidden layer i, the last one feeds the output layer
+	int layerCount = network->hiddenLayerList.size();
+	std::vector<float_n> rangeMin(layerCount + 1, FLT_MAX), rangeMax(layerCount + 1, -FLT_MAX);
+
+	FullConnNetworkBatch batch(network, CalibrationBatchSize);
+
+	auto observe = [&](NeuronLayerBatch& layer, int index, int count)
+	{
+		for (int sample = 0; sample < count; sample++)
+		{
+			float_n* value = layer.Sample(sample);
+
+			for (int i = 0; i < layer.neuronCount; i++)
+			{
+				rangeMin[index] = std::min(rangeMin[index], value[i]);
+				rangeMax[index] = std::max(rangeMax[index], value[i]);
+			}
+		}
+	};
+
+	for (int first = 0; first < samples.size(); first += CalibrationBatchSize)
+	{
+		int count = std::min(CalibrationBatchSize, (int)samples.size() - first);
+
+		for (int i = 0; i < count; i++)
+			batch.PushData(i, samples[first + i]);
+
+		batch.ForwardTransmit(count);
+
+		observe(batch.inLayer, 0, count);
+		for (int i = 0; i < layerCount; i++)
+			observe(batch.hiddenLayerList[i], i + 1, count);
+	}
+
+	batch.FreeData();
+
+	for (int i = 0; i < layerCount; i++)
+		hiddenLayerList.push_back(QuantizedLayer(network->hiddenLayerList[i], rangeMin[i], rangeMax[i]));
+
+	outLayer = QuantizedLayer(network->outLayer, rangeMin[layerCount], rangeMax[layerCount]);
+}
+
+void QuantizedNetwork::Destroy()
+{
+	for (auto& layer : hiddenLayerList)
+		layer.Free();
+
+	hiddenLayerList.clear();
+	outLayer.Free();
+}
+
+QuantizedNetworkBatch::QuantizedNetworkBatch(QuantizedNetwork* src, int batchSize)
+{
+	if (batchSize <= 0)
+		throw std::exception("Invalid Parameters");
+
+	source = src;
+	this->batchSize = batchSize;
+
+	inStride = AlignedStride(source->inNeuronCount);
+	outStride = AlignedStride(source->outNeuronCount);
+
+	// widest layer, on either side
+	int widest = std::max(source->inNeuronCount, source->outNeuronCount);
+	for (auto& layer : source->hiddenLayerList)
+		widest = std::max(widest, layer.neuronCount);
+
+	valueStride = AlignedStride(widest);
+
+	input = AlignedAlloc((size_t)batchSize * inStride);
+	output = AlignedAlloc((size_t)batchSize * outStride);
+	value[0] = AlignedAlloc((size_t)batchSize * valueStride);
+	value[1] = AlignedAlloc((size_t)batchSize * valueStride);
+
+	quantized = (unsigned char*)AlignedAlloc((size_t)batchSize * valueStride / sizeof(float_n));
+	sum = (int*)AlignedAlloc((size_t)batchSize * valueStride);
+}
+
+void QuantizedNetworkBatch::PushData(int index, float_n* data)
+{
+	memcpy(GetInput(index), data, sizeof(float_n) * source->inNeuronCount);
+}
+
+float_n* QuantizedNetworkBatch::GetInput(int index)
+{
+	return input + (size_t)index * inStride;
+}
+
+float_n* QuantizedNetworkBatch::GetOutput(int index)
+{
+	return output + (size_t)index * outStride;
+}
+
+void QuantizedNetworkBatch::FreeData()
+{
+	AlignedFree(input);
+	AlignedFree(output);
+	AlignedFree(value[0]);
+	AlignedFree(value[1]);
+	AlignedFree((float_n*)quantized);
+	AlignedFree((float_n*)sum);
+}
+
+void QuantizedNetworkBatch::ForwardTransmitLayer(QuantizedLayer& layer, float_n* in, int inRowStride, float_n* out, int outRowStride, ActivateFunctionType type, int count)
+{
+	for (int sample = 0; sample < count; sample++)
+		layer.QuantizeInput(in + (size_t)sample * inRowStride, quantized + (size_t)sample * valueStride);
+
+	MatrixAccelator::GemmU8S8(count, layer.neuronCount, layer.prevCount, quantized, valueStride, layer.weights, sum, valueStride);
+
+	for (int sample = 0; sample < count; sample++)
+	{
+		float_n* value = out + (size_t)sample * outRowStride;
+
+		layer.Dequantize(sum + (size_t)sample * valueStride, value);
+		ActivateVector(type, value, layer.neuronCount, 1.0f, 0.0f);
+	}
+}
+
+void QuantizedNetworkBatch::ForwardTransmit(int count)
+{
+	if (count > batchSize)
+		throw std::exception("Batch Overflow!");
+
+	float_n* in = input;
+	int stride = inStride;
+
+	for (int i = 0; i < source->hiddenLayerList.size(); i++)
+	{
+		ForwardTransmitLayer(source->hiddenLayerList[i], in, stride, value[i % 2], valueStride, source->ActivateFunc, count);
+
+		in = value[i % 2];
+		stride = valueStride;
+	}
+
+	ForwardTransmitLayer(source->outLayer, in, stride, output, outStride, ActivateFunctionType::Linear, count);
+}
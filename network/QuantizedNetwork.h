@@ -0,0 +1,109 @@
+#ifndef _QUANTIZED_NETWORK_H_
+#define _QUANTIZED_NETWORK_H_
+
+#include <vector>
+
+#include "NetworkStructure.h"
+#include "NetworkAlgorithm.h"
+#include "NetworkFramework.h"
+
+namespace Network
+{
+	// Quantized activations are 7-bit, so u8 x s8 pair sums of maddubs never saturate int16
+	const int QuantizedInputMax = 127;
+	const int QuantizedWeightMax = 127;
+
+	// Int8 copy of a NeuronLayer's weights for inference, one scale per neuron
+	// Inputs are quantized asymmetrically: x = inputScale * (q - inputZero), q in [0, 127]
+	class QuantizedLayer
+	{
+	public:
+		signed char* weights; // packed for MatrixAccelator::GemmU8S8
+
+		// Dequantization with bias and 1/prevCount folded in: x = sum * outputScale + outputShift
+		float_n* outputScale;
+		float_n* outputShift;
+
+		int prevCount;
+		int neuronCount;
+
+		float_n inputScale;
+		int inputZero;
+
+		/// <summary>
+		/// Quantize the weights of a layer, whose inputs were observed within [inputMin, inputMax]
+		/// </summary>
+		QuantizedLayer(NeuronLayer& layer, float_n inputMin, float_n inputMax);
+		QuantizedLayer() :weights(nullptr), outputScale(nullptr), outputShift(nullptr), prevCount(0), neuronCount(0), inputScale(1), inputZero(0) {}
+
+		/// <summary>
+		/// Quantize prevCount inputs into q
+		/// </summary>
+		void QuantizeInput(const float_n* x, unsigned char* q);
+
+		/// <summary>
+		/// Turn the integer products of a sample back into pre-activation values
+		/// </summary>
+		void Dequantize(const int* sum, float_n* out);
+
+		void Free();
+	};
+
+	namespace Connectivity
+	{
+		// Post-training int8 quantization of a FullConnNetwork, inference only
+		// Weights take a quarter of the float storage, products accumulate in int32
+		class QuantizedNetwork
+		{
+		public:
+			ActivateFunctionType ActivateFunc;
+
+			int inNeuronCount, outNeuronCount;
+
+			std::vector<QuantizedLayer> hiddenLayerList;
+			QuantizedLayer outLayer;
+
+			/// <summary>
+			/// Quantize a network, input ranges of every layer are calibrated by transmitting the samples through it
+			/// </summary>
+			/// <param name="samples">Input vectors of inNeuronCount elements</param>
+			QuantizedNetwork(FullConnNetwork* network, std::vector<float_n*>& samples);
+
+			void Destroy();
+		};
+
+		// Transmits a batch of samples through a QuantizedNetwork, mirrors FullConnNetworkBatch
+		// Every layer quantizes the whole batch, then multiplies it as one integer matrix product
+		class QuantizedNetworkBatch
+		{
+		public:
+			QuantizedNetwork* source;
+
+			int batchSize; // capacity, in samples
+			int inStride, outStride, valueStride;
+
+			float_n* input; // row-major, one row of inStride elements per sample
+			float_n* output; // row-major, one row of outStride elements per sample
+			float_n* value[2]; // activations of hidden layers, alternating, one row of valueStride per sample
+
+			unsigned char* quantized; // quantized inputs of the current layer, one row of valueStride bytes per sample
+			int* sum; // integer products of the current layer, one row of valueStride per sample
+
+			QuantizedNetworkBatch(QuantizedNetwork* src, int batchSize);
+
+			// Data Management
+
+			void PushData(int index, float_n* data);
+			float_n* GetInput(int index);
+			float_n* GetOutput(int index);
+			void FreeData();
+
+			// Transmission
+
+			void ForwardTransmit(int count);
+			void ForwardTransmitLayer(QuantizedLayer& layer, float_n* in, int inRowStride, float_n* out, int outRowStride, ActivateFunctionType type, int count);
+		};
+	}
+}
+
+#endif
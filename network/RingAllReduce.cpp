@@ -0,0 +1,456 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include "RingAllReduce.h"
+#include "VectorAccelator.h"
+
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+using namespace Network;
+
+// ---------- Sockets ----------
+
+#ifdef _WIN32
+
+static const SOCKET NoSocket = INVALID_SOCKET;
+
+static void CloseSocket(SOCKET socket)
+{
+	closesocket(socket);
+}
+
+static bool WouldBlock()
+{
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+static void SetNonBlocking(SOCKET socket)
+{
+	u_long on = 1;
+	ioctlsocket(socket, FIONBIO, &on);
+}
+
+static void StartNetworking()
+{
+	static bool started = false;
+	static std::mutex startLock;
+
+	std::lock_guard<std::mutex> guard(startLock);
+	if (started)
+		return;
+
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+		throw std::exception("Winsock Failed!");
+
+	started = true;
+}
+
+#else
+
+typedef int SOCKET;
+static const SOCKET NoSocket = -1;
+
+static void CloseSocket(SOCKET socket)
+{
+	close(socket);
+}
+
+static bool WouldBlock()
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void SetNonBlocking(SOCKET socket)
+{
+	fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static void StartNetworking()
+{
+}
+
+#endif
+
+// A peer that went away must surface as an error, not as SIGPIPE
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;
+#else
+static const int SendFlags = 0;
+#endif
+
+// Largest piece handed to a single send or recv
+static const size_t MaxTransfer = 1 << 20;
+
+static void SetNoDelay(SOCKET socket)
+{
+	// the last chunks of a sum are small, Nagle would hold them back
+	int on = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+}
+
+// Blocking send or receive of a whole buffer, only used while the ring is set up
+static bool SendAll(SOCKET socket, const char* data, int bytes)
+{
+	while (bytes > 0)
+	{
+		int count = send(socket, data, bytes, SendFlags);
+		if (count <= 0) return false;
+		data += count;
+		bytes -= count;
+	}
+	return true;
+}
+
+static bool ReceiveAll(SOCKET socket, char* data, int bytes)
+{
+	while (bytes > 0)
+	{
+		int count = recv(socket, data, bytes, 0);
+		if (count <= 0) return false;
+		data += count;
+		bytes -= count;
+	}
+	return true;
+}
+
+// The next rank may not listen yet, keep trying until the deadline
+static SOCKET Connect(const std::string& host, int port, int timeoutSeconds)
+{
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	addrinfo* address = nullptr;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &address) != 0 || !address)
+		return NoSocket;
+
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+	SOCKET result = NoSocket;
+
+	while (result == NoSocket && std::chrono::steady_clock::now() < deadline)
+	{
+		SOCKET candidate = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+
+		if (candidate != NoSocket && connect(candidate, address->ai_addr, (int)address->ai_addrlen) == 0)
+		{
+			result = candidate;
+			break;
+		}
+
+		if (candidate != NoSocket)
+			CloseSocket(candidate);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	freeaddrinfo(address);
+	return result;
+}
+
+static SOCKET Accept(SOCKET listener, int timeoutSeconds)
+{
+	fd_set readable;
+	FD_ZERO(&readable);
+	FD_SET(listener, &readable);
+
+	timeval timeout = { timeoutSeconds, 0 };
+	if (select((int)listener + 1, &readable, nullptr, nullptr, &timeout) <= 0)
+		return NoSocket;
+
+	return accept(listener, nullptr, nullptr);
+}
+
+// ---------- Ring ----------
+
+static void AddInto(const float* x, float* y, size_t count)
+{
+	VectorAccelator::Axpy(1.0f, x, y, count);
+}
+
+static void AddInto(const double* x, double* y, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		y[i] += x[i];
+}
+
+RingAllReduce::RingAllReduce(int rank, int worldSize, const std::string& nextHost, int basePort, int timeoutSeconds)
+{
+	if (worldSize <= 0 || rank < 0 || rank >= worldSize || basePort <= 0 || basePort + worldSize > 65536)
+		throw std::exception("Invalid Parameters");
+
+	this->rank = rank;
+	this->worldSize = worldSize;
+
+	sendSocket = receiveSocket = NoSocket;
+	busy = quit = false;
+
+	if (worldSize > 1)
+	{
+		StartNetworking();
+
+		SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (listener == NoSocket)
+			throw std::exception("Socket Failed!");
+
+		int on = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons((unsigned short)(basePort + rank));
+
+		if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1) != 0)
+		{
+			CloseSocket(listener);
+			throw std::exception("Listen Failed!");
+		}
+
+		// listening first: the connection to rank + 1 completes as soon as it listens, accepted or not,
+		// so no rank waits on another one to accept
+		sendSocket = Connect(nextHost, basePort + (rank + 1) % worldSize, timeoutSeconds);
+		receiveSocket = sendSocket == NoSocket ? NoSocket : Accept(listener, timeoutSeconds);
+		CloseSocket(listener);
+
+		if (receiveSocket == NoSocket)
+		{
+			Close();
+			throw std::exception("Connection Failed!");
+		}
+
+		// ranks introduce themselves, so a ring wired to the wrong ports fails here rather than summing garbage
+		int own = rank, previous = -1;
+		if (!SendAll(sendSocket, (const char*)&own, sizeof(own)) || !ReceiveAll(receiveSocket, (char*)&previous, sizeof(previous)) ||
+			previous != (rank + worldSize - 1) % worldSize)
+		{
+			Close();
+			throw std::exception("Ring Mismatch!");
+		}
+
+		SetNoDelay(sendSocket);
+		SetNoDelay(receiveSocket);
+		SetNonBlocking(sendSocket);
+		SetNonBlocking(receiveSocket);
+	}
+
+	worker = std::thread(&RingAllReduce::WorkerMain, this);
+}
+
+RingAllReduce::~RingAllReduce()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	signal.notify_all();
+
+	worker.join();
+	Close();
+}
+
+int RingAllReduce::Rank()
+{
+	return rank;
+}
+
+int RingAllReduce::WorldSize()
+{
+	return worldSize;
+}
+
+void RingAllReduce::Submit(float* data, size_t count)
+{
+	Enqueue([this, data, count] { Reduce(data, count); });
+}
+
+void RingAllReduce::Submit(double* data, size_t count)
+{
+	Enqueue([this, data, count] { Reduce(data, count); });
+}
+
+void RingAllReduce::Wait()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	doneSignal.wait(guard, [this] { return jobs.empty() && !busy; });
+
+	if (error)
+	{
+		std::exception_ptr failure = error;
+		error = nullptr;
+		std::rethrow_exception(failure);
+	}
+}
+
+void RingAllReduce::Broadcast(float* data, size_t count, int root)
+{
+	// a sum where every other rank adds zeros
+	if (rank != root)
+		memset(data, 0, sizeof(float) * count);
+
+	Submit(data, count);
+	Wait();
+}
+
+void RingAllReduce::Broadcast(double* data, size_t count, int root)
+{
+	if (rank != root)
+		memset(data, 0, sizeof(double) * count);
+
+	Submit(data, count);
+	Wait();
+}
+
+void RingAllReduce::Enqueue(Job job)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		jobs.push_back(job);
+	}
+	signal.notify_one();
+}
+
+void RingAllReduce::WorkerMain()
+{
+	while (1)
+	{
+		Job job;
+		bool failed;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			signal.wait(guard, [this] { return quit || !jobs.empty(); });
+
+			// quits once the queue is drained
+			if (jobs.empty())
+				return;
+
+			job = jobs.front();
+			jobs.pop_front();
+			busy = true;
+			failed = error != nullptr;
+		}
+
+		// once the ring broke, later sums would hang or mix up chunks, they are dropped
+		if (!failed)
+		{
+			try
+			{
+				job();
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				error = std::current_exception();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			busy = false;
+		}
+		doneSignal.notify_all();
+	}
+}
+
+template<typename T>
+void RingAllReduce::Reduce(T* data, size_t count)
+{
+	if (worldSize == 1 || count == 0)
+		return;
+
+	auto offset = [&](int chunk) { return count * chunk / worldSize; };
+	auto size = [&](int chunk) { return offset(chunk + 1) - offset(chunk); };
+
+	scratch.resize(sizeof(T) * (count / worldSize + 1));
+	T* incoming = (T*)scratch.data();
+
+	// reduce-scatter: chunks travel along the ring picking up one rank at a time,
+	// afterwards this rank holds the whole sum of chunk rank + 1
+	for (int step = 0; step < worldSize - 1; step++)
+	{
+		int sendChunk = (rank - step + worldSize) % worldSize;
+		int receiveChunk = (rank - step - 1 + 2 * worldSize) % worldSize;
+
+		Exchange((const char*)(data + offset(sendChunk)), sizeof(T) * size(sendChunk), (char*)incoming, sizeof(T) * size(receiveChunk));
+		AddInto(incoming, data + offset(receiveChunk), size(receiveChunk));
+	}
+
+	// all-gather: the sums travel along the ring and overwrite the partial chunks
+	for (int step = 0; step < worldSize - 1; step++)
+	{
+		int sendChunk = (rank + 1 - step + worldSize) % worldSize;
+		int receiveChunk = (rank - step + worldSize) % worldSize;
+
+		Exchange((const char*)(data + offset(sendChunk)), sizeof(T) * size(sendChunk), (char*)(data + offset(receiveChunk)), sizeof(T) * size(receiveChunk));
+	}
+}
+
+void RingAllReduce::Exchange(const char* sendData, size_t sendBytes, char* receiveData, size_t receiveBytes)
+{
+	size_t sent = 0, received = 0;
+
+	while (sent < sendBytes || received < receiveBytes)
+	{
+		fd_set writable, readable;
+		FD_ZERO(&writable);
+		FD_ZERO(&readable);
+
+		if (sent < sendBytes) FD_SET(sendSocket, &writable);
+		if (received < receiveBytes) FD_SET(receiveSocket, &readable);
+
+		int highest = (int)std::max(sendSocket, receiveSocket);
+		if (select(highest + 1, &readable, &writable, nullptr, nullptr) < 0)
+		{
+			if (WouldBlock()) continue;
+			throw std::exception("Select Failed!");
+		}
+
+		if (sent < sendBytes && FD_ISSET(sendSocket, &writable))
+		{
+			int count = send(sendSocket, sendData + sent, (int)std::min(sendBytes - sent, MaxTransfer), SendFlags);
+
+			if (count > 0)
+				sent += count;
+			else if (count < 0 && !WouldBlock())
+				throw std::exception("Send Failed!");
+		}
+
+		if (received < receiveBytes && FD_ISSET(receiveSocket, &readable))
+		{
+			int count = recv(receiveSocket, receiveData + received, (int)std::min(receiveBytes - received, MaxTransfer), 0);
+
+			if (count > 0)
+				received += count;
+			else if (count == 0)
+				throw std::exception("Connection Closed!");
+			else if (!WouldBlock())
+				throw std::exception("Receive Failed!");
+		}
+	}
+}
+
+void RingAllReduce::Close()
+{
+	if (sendSocket != NoSocket)
+		CloseSocket(sendSocket);
+	if (receiveSocket != NoSocket)
+		CloseSocket(receiveSocket);
+
+	sendSocket = receiveSocket = NoSocket;
+}
@@ -0,0 +1,97 @@
+#ifndef _RING_ALL_REDUCE_H_
+#define _RING_ALL_REDUCE_H_
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstdint>
+
+namespace Network
+{
+	// Sums buffers across processes with a ring all-reduce over TCP
+	// Rank r listens on basePort + r, sends to rank r + 1 and receives from rank r - 1
+	// A buffer is cut into worldSize chunks: worldSize - 1 steps reduce every chunk onto one rank, worldSize - 1 more pass the sums on,
+	// so every rank moves 2 * (worldSize - 1) / worldSize of the buffer whatever the number of ranks,
+	// and every rank ends with the same bits
+	// Submitted sums run in order on a communication thread, overlapping with whatever the caller computes meanwhile
+	class RingAllReduce
+	{
+	public:
+		/// <summary>
+		/// Join the ring, blocks until both neighbours are connected
+		/// </summary>
+		/// <param name="nextHost">Address of rank + 1, 127.0.0.1 when every rank runs on this machine</param>
+		/// <param name="timeoutSeconds">How long to keep retrying the connection to rank + 1</param>
+		RingAllReduce(int rank, int worldSize, const std::string& nextHost, int basePort, int timeoutSeconds = 60);
+
+		/// <summary>
+		/// Finishes the submitted sums, then leaves the ring
+		/// </summary>
+		~RingAllReduce();
+
+		RingAllReduce(const RingAllReduce&) = delete;
+		RingAllReduce& operator=(const RingAllReduce&) = delete;
+
+		int Rank();
+		int WorldSize();
+
+		/// <summary>
+		/// Queue an in-place sum of data across ranks, every rank must submit the same sequence of counts and types
+		/// data must stay valid and untouched until Wait() returns
+		/// </summary>
+		void Submit(float* data, size_t count);
+		void Submit(double* data, size_t count);
+
+		/// <summary>
+		/// Block until every submitted sum is done, the first communication error is rethrown here
+		/// </summary>
+		void Wait();
+
+		/// <summary>
+		/// Replace data with the data of root on every rank, blocking
+		/// </summary>
+		void Broadcast(float* data, size_t count, int root);
+		void Broadcast(double* data, size_t count, int root);
+
+	private:
+		typedef std::function<void()> Job;
+
+		int rank, worldSize;
+
+#ifdef _WIN32
+		typedef uintptr_t Socket; // SOCKET
+#else
+		typedef int Socket;
+#endif
+		Socket sendSocket, receiveSocket; // to rank + 1, from rank - 1
+
+		std::vector<char> scratch; // received chunks before they are added
+
+		std::thread worker;
+		std::mutex lock;
+		std::condition_variable signal, doneSignal;
+		std::deque<Job> jobs;
+		bool busy, quit;
+		std::exception_ptr error;
+
+		void WorkerMain();
+		void Enqueue(Job job);
+
+		template<typename T>
+		void Reduce(T* data, size_t count);
+
+		/// <summary>
+		/// Send to rank + 1 and receive from rank - 1 at the same time, neither side can fill the socket buffers and stall
+		/// </summary>
+		void Exchange(const char* sendData, size_t sendBytes, char* receiveData, size_t receiveBytes);
+
+		void Close();
+	};
+}
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+
+// Vectorized transcendental functions shared by the SIMD kernels
+
+#include "SIMDTarget.h"
+
+// Cephes-style exp: exp(x) = 2^n * exp(r), |r| <= ln2 / 2, exp(r) by a degree-5 polynomial
+static const float ExpMax = 88.3762626647949f;
+static const float ExpMin = -88.3762626647949f;
+static const float ExpLog2e = 1.44269504088896341f;
+static const float ExpC1 = 0.693359375f;
+static const float ExpC2 = -2.12194440e-4f;
+static const float ExpP0 = 1.9875691500E-4f;
+static const float ExpP1 = 1.3981999507E-3f;
+static const float ExpP2 = 8.3334519073E-3f;
+static const float ExpP3 = 4.1665795894E-2f;
+static const float ExpP4 = 1.6666665459E-1f;
+static const float ExpP5 = 5.0000001201E-1f;
+
+#ifdef VA_X86
+
+TARGET_AVX2 static inline __m256 Exp_AVX2(__m256 x)
+{
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(ExpMin)), _mm256_set1_ps(ExpMax));
+
+	__m256 n = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(ExpLog2e), _mm256_set1_ps(0.5f)));
+	x = _mm256_fnmadd_ps(n, _mm256_set1_ps(ExpC1), x);
+	x = _mm256_fnmadd_ps(n, _mm256_set1_ps(ExpC2), x);
+
+	__m256 y = _mm256_set1_ps(ExpP0);
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(ExpP1));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(ExpP2));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(ExpP3));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(ExpP4));
+	y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(ExpP5));
+	y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+
+	__m256i pow2n = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(y, _mm256_castsi256_ps(pow2n));
+}
+
+TARGET_AVX2 static inline __m256 Sigmoid8_AVX2(__m256 x)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	return _mm256_div_ps(one, _mm256_add_ps(one, Exp_AVX2(_mm256_sub_ps(_mm256_setzero_ps(), x))));
+}
+
+TARGET_AVX512 static inline __m512 Exp_AVX512(__m512 x)
+{
+	x = _mm512_min_ps(_mm512_max_ps(x, _mm512_set1_ps(ExpMin)), _mm512_set1_ps(ExpMax));
+
+	__m512 n = _mm512_roundscale_ps(_mm512_fmadd_ps(x, _mm512_set1_ps(ExpLog2e), _mm512_set1_ps(0.5f)), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+	x = _mm512_fnmadd_ps(n, _mm512_set1_ps(ExpC1), x);
+	x = _mm512_fnmadd_ps(n, _mm512_set1_ps(ExpC2), x);
+
+	__m512 y = _mm512_set1_ps(ExpP0);
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(ExpP1));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(ExpP2));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(ExpP3));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(ExpP4));
+	y = _mm512_fmadd_ps(y, x, _mm512_set1_ps(ExpP5));
+	y = _mm512_fmadd_ps(y, _mm512_mul_ps(x, x), _mm512_add_ps(x, _mm512_set1_ps(1.0f)));
+
+	return _mm512_scalef_ps(y, n);
+}
+
+TARGET_AVX512 static inline __m512 Sigmoid16_AVX512(__m512 x)
+{
+	const __m512 one = _mm512_set1_ps(1.0f);
+	return _mm512_div_ps(one, _mm512_add_ps(one, Exp_AVX512(_mm512_sub_ps(_mm512_setzero_ps(), x))));
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+// Shared by the SIMD kernel translation units
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VA_X86
+#include <immintrin.h>
+#endif
+
+// GCC and Clang only emit instructions enabled for a function, MSVC accepts any intrinsic
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#define TARGET_AVX512VNNI __attribute__((target("avx512f,avx512bw,avx512vnni")))
+#define TARGET_AVX512BF16 __attribute__((target("avx512f,avx512bw,avx512bf16")))
+#else
+#define TARGET_SSE
+#define TARGET_AVX2
+#define TARGET_AVX512
+#define TARGET_AVX512VNNI
+#define TARGET_AVX512BF16
+#endif
@@ -1,13 +1,1170 @@
 #include "VectorAccelator.h"
+#include "SIMDTarget.h"
+#include "SIMDMath.h"
 
-float VectorAccelator::Dot(const float* a, const float* b, unsigned int count)
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef VA_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+typedef float (*DotKernel)(const float*, const float*, unsigned int);
+typedef void (*Dot4Kernel)(const float*, unsigned int, const float*, unsigned int, float*);
+typedef void (*AxpyKernel)(float, const float*, float*, unsigned int);
+typedef void (*Axpy4Kernel)(const float*, const float*, unsigned int, float*, unsigned int);
+typedef void (*ScaleKernel)(float, float*, unsigned int);
+typedef void (*SigmoidKernel)(float*, unsigned int);
+typedef void (*QuantizeKernel)(const float*, float, float, unsigned char*, unsigned int);
+typedef void (*DequantizeKernel)(const int*, const float*, const float*, float*, unsigned int);
+typedef void (*WidenKernel)(const unsigned short*, float*, unsigned int);
+typedef void (*NarrowKernel)(const float*, unsigned short*, unsigned int);
+typedef void (*MomentumKernel)(float*, float*, const float*, unsigned int, float, float, bool);
+typedef void (*AdamKernel)(float*, float*, float*, const float*, unsigned int, float, float, float, float);
+
+struct KernelTable
+{
+	SIMDLevel level;
+	DotKernel dot;
+	Dot4Kernel dot4;
+	AxpyKernel axpy;
+	Axpy4Kernel axpy4;
+	ScaleKernel scale;
+	SigmoidKernel sigmoid;
+	QuantizeKernel quantizeU7;
+	DequantizeKernel dequantize;
+	WidenKernel fp16ToFloat, bf16ToFloat;
+	NarrowKernel floatToFP16, floatToBF16;
+	MomentumKernel momentumStep;
+	AdamKernel adamStep;
+	DotKernel squaredDistance;
+};
+
+// ---------- Scalar reference kernels ----------
+
+static float Dot_Scalar(const float* a, const float* b, unsigned int count)
+{
+	float sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		sum0 += a[i] * b[i];
+		sum1 += a[i + 1] * b[i + 1];
+		sum2 += a[i + 2] * b[i + 2];
+		sum3 += a[i + 3] * b[i + 3];
+	}
+
+	for (; i < count; i++)
+		sum0 += a[i] * b[i];
+
+	return (sum0 + sum1) + (sum2 + sum3);
+}
+
+static float SquaredDistance_Scalar(const float* a, const float* b, unsigned int count)
 {
-	float sum = 0;
+	float sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+	unsigned int i = 0;
 
+	for (; i + 4 <= count; i += 4)
+	{
+		float d0 = a[i] - b[i], d1 = a[i + 1] - b[i + 1], d2 = a[i + 2] - b[i + 2], d3 = a[i + 3] - b[i + 3];
+		sum0 += d0 * d0;
+		sum1 += d1 * d1;
+		sum2 += d2 * d2;
+		sum3 += d3 * d3;
+	}
+
+	for (; i < count; i++)
+		sum0 += (a[i] - b[i]) * (a[i] - b[i]);
+
+	return (sum0 + sum1) + (sum2 + sum3);
+}
+
+static void Dot4_Scalar(const float* rows, unsigned int stride, const float* x, unsigned int count, float* out)
+{
+	for (int row = 0; row < 4; row++)
+		out[row] = Dot_Scalar(rows + (size_t)row * stride, x, count);
+}
+
+static void Axpy_Scalar(float alpha, const float* x, float* y, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		y[i] += alpha * x[i];
+}
+
+static void Axpy4_Scalar(const float* alpha, const float* rows, unsigned int stride, float* y, unsigned int count)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+
+	for (unsigned int i = 0; i < count; i++)
+		y[i] += (alpha[0] * r0[i] + alpha[1] * r1[i]) + (alpha[2] * r2[i] + alpha[3] * r3[i]);
+}
+
+static void Scale_Scalar(float alpha, float* x, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		x[i] *= alpha;
+}
+
+static void Sigmoid_Scalar(float* x, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		x[i] = 1.0f / (1.0f + expf(-x[i]));
+}
+
+static void QuantizeU7_Scalar(const float* x, float scale, float shift, unsigned char* q, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		q[i] = (unsigned char)lrintf(std::clamp(x[i] * scale + shift, 0.0f, 127.0f));
+}
+
+static void Dequantize_Scalar(const int* x, const float* scale, const float* shift, float* y, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+		y[i] = (float)x[i] * scale[i] + shift[i];
+}
+
+static void FP16ToFloat_Scalar(const unsigned short* x, float* y, unsigned int count)
+{
 	for (unsigned int i = 0; i < count; i++)
 	{
+		unsigned int sign = (x[i] & 0x8000u) << 16;
+		unsigned int exponent = (x[i] >> 10) & 0x1F;
+		unsigned int mantissa = x[i] & 0x3FF;
+		unsigned int bits;
+
+		if (exponent == 0x1F)
+			bits = sign | 0x7F800000u | (mantissa << 13); // inf, nan
+		else if (exponent != 0)
+			bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+		else if (mantissa == 0)
+			bits = sign;
+		else
+		{
+			// subnormal, normalize
+			exponent = 113;
+			while (!(mantissa & 0x400))
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+		}
+
+		memcpy(y + i, &bits, sizeof(float));
+	}
+}
+
+static void FloatToFP16_Scalar(const float* x, unsigned short* y, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int bits;
+		memcpy(&bits, x + i, sizeof(float));
+
+		unsigned int sign = (bits >> 16) & 0x8000u;
+		unsigned int magnitude = bits & 0x7FFFFFFFu;
+		unsigned int half;
+
+		if (magnitude >= 0x7F800000u)
+			half = magnitude > 0x7F800000u ? 0x7E00u : 0x7C00u; // nan, inf
+		else if (magnitude >= 0x477FF000u)
+			half = 0x7C00u; // rounds beyond 65504
+		else if (magnitude >= 0x38800000u)
+		{
+			// normal, round mantissa to nearest even
+			unsigned int rounded = magnitude + 0xFFFu + ((magnitude >> 13) & 1);
+			half = (rounded - 0x38000000u) >> 13;
+		}
+		else
+		{
+			// subnormal or zero, scale by 2^24 and round to an integer
+			float scaled;
+			memcpy(&scaled, &magnitude, sizeof(float));
+			half = (unsigned int)lrintf(scaled * 16777216.0f);
+		}
+
+		y[i] = (unsigned short)(sign | half);
+	}
+}
+
+static void BF16ToFloat_Scalar(const unsigned short* x, float* y, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int bits = (unsigned int)x[i] << 16;
+		memcpy(y + i, &bits, sizeof(float));
+	}
+}
+
+static void FloatToBF16_Scalar(const float* x, unsigned short* y, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int bits;
+		memcpy(&bits, x + i, sizeof(float));
+
+		if ((bits & 0x7FFFFFFFu) > 0x7F800000u)
+			y[i] = (unsigned short)((bits >> 16) | 0x40); // keep nan quiet
+		else
+			y[i] = (unsigned short)((bits + 0x7FFFu + ((bits >> 16) & 1)) >> 16);
+	}
+}
+
+static void MomentumStep_Scalar(float* w, float* m, const float* d, unsigned int count, float learningRate, float momentum, bool nesterov)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		m[i] = momentum * m[i] + d[i];
+		w[i] += learningRate * (nesterov ? momentum * m[i] + d[i] : m[i]);
+	}
+}
+
+static void AdamStep_Scalar(float* w, float* m, float* v, const float* d, unsigned int count, float learningRate, float beta1, float beta2, float epsilon)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		m[i] = beta1 * m[i] + (1.0f - beta1) * d[i];
+		v[i] = beta2 * v[i] + (1.0f - beta2) * d[i] * d[i];
+		w[i] += learningRate * m[i] / (sqrtf(v[i]) + epsilon);
+	}
+}
+
+#ifdef VA_X86
+
+// ---------- SSE kernels ----------
+
+TARGET_SSE static inline float HorizontalSum_SSE(__m128 v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+TARGET_SSE static float Dot_SSE(const float* a, const float* b, unsigned int count)
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(a + i + 8), _mm_loadu_ps(b + i + 8)));
+		sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(a + i + 12), _mm_loadu_ps(b + i + 12)));
+	}
+
+	for (; i + 4 <= count; i += 4)
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+	float sum = HorizontalSum_SSE(_mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3)));
+
+	for (; i < count; i++)
 		sum += a[i] * b[i];
+
+	return sum;
+}
+
+TARGET_SSE static float SquaredDistance_SSE(const float* a, const float* b, unsigned int count)
+{
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+		__m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(d0, d0));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(d1, d1));
+	}
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 d = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(d, d));
 	}
 
+	float sum = HorizontalSum_SSE(_mm_add_ps(sum0, sum1));
+
+	for (; i < count; i++)
+		sum += (a[i] - b[i]) * (a[i] - b[i]);
+
 	return sum;
 }
+
+TARGET_SSE static void Dot4_SSE(const float* rows, unsigned int stride, const float* x, unsigned int count, float* out)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 xv = _mm_loadu_ps(x + i);
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(r0 + i), xv));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(r1 + i), xv));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(_mm_loadu_ps(r2 + i), xv));
+		sum3 = _mm_add_ps(sum3, _mm_mul_ps(_mm_loadu_ps(r3 + i), xv));
+	}
+
+	out[0] = HorizontalSum_SSE(sum0);
+	out[1] = HorizontalSum_SSE(sum1);
+	out[2] = HorizontalSum_SSE(sum2);
+	out[3] = HorizontalSum_SSE(sum3);
+
+	for (; i < count; i++)
+	{
+		out[0] += r0[i] * x[i];
+		out[1] += r1[i] * x[i];
+		out[2] += r2[i] * x[i];
+		out[3] += r3[i] * x[i];
+	}
+}
+
+TARGET_SSE static void Axpy_SSE(float alpha, const float* x, float* y, unsigned int count)
+{
+	__m128 a = _mm_set1_ps(alpha);
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(a, _mm_loadu_ps(x + i))));
+
+	for (; i < count; i++)
+		y[i] += alpha * x[i];
+}
+
+TARGET_SSE static void Axpy4_SSE(const float* alpha, const float* rows, unsigned int stride, float* y, unsigned int count)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+	__m128 a0 = _mm_set1_ps(alpha[0]), a1 = _mm_set1_ps(alpha[1]), a2 = _mm_set1_ps(alpha[2]), a3 = _mm_set1_ps(alpha[3]);
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 sum01 = _mm_add_ps(_mm_mul_ps(a0, _mm_loadu_ps(r0 + i)), _mm_mul_ps(a1, _mm_loadu_ps(r1 + i)));
+		__m128 sum23 = _mm_add_ps(_mm_mul_ps(a2, _mm_loadu_ps(r2 + i)), _mm_mul_ps(a3, _mm_loadu_ps(r3 + i)));
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_add_ps(sum01, sum23)));
+	}
+
+	for (; i < count; i++)
+		y[i] += (alpha[0] * r0[i] + alpha[1] * r1[i]) + (alpha[2] * r2[i] + alpha[3] * r3[i]);
+}
+
+TARGET_SSE static void Scale_SSE(float alpha, float* x, unsigned int count)
+{
+	__m128 a = _mm_set1_ps(alpha);
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(x + i, _mm_mul_ps(a, _mm_loadu_ps(x + i)));
+
+	for (; i < count; i++)
+		x[i] *= alpha;
+}
+
+TARGET_SSE static void MomentumStep_SSE(float* w, float* m, const float* d, unsigned int count, float learningRate, float momentum, bool nesterov)
+{
+	__m128 lr = _mm_set1_ps(learningRate), mu = _mm_set1_ps(momentum);
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 dv = _mm_loadu_ps(d + i);
+		__m128 mv = _mm_add_ps(_mm_mul_ps(mu, _mm_loadu_ps(m + i)), dv);
+		__m128 step = nesterov ? _mm_add_ps(_mm_mul_ps(mu, mv), dv) : mv;
+
+		_mm_storeu_ps(m + i, mv);
+		_mm_storeu_ps(w + i, _mm_add_ps(_mm_loadu_ps(w + i), _mm_mul_ps(lr, step)));
+	}
+
+	MomentumStep_Scalar(w + i, m + i, d + i, count - i, learningRate, momentum, nesterov);
+}
+
+TARGET_SSE static void AdamStep_SSE(float* w, float* m, float* v, const float* d, unsigned int count, float learningRate, float beta1, float beta2, float epsilon)
+{
+	__m128 lr = _mm_set1_ps(learningRate), eps = _mm_set1_ps(epsilon);
+	__m128 b1 = _mm_set1_ps(beta1), b2 = _mm_set1_ps(beta2), c1 = _mm_set1_ps(1.0f - beta1), c2 = _mm_set1_ps(1.0f - beta2);
+	unsigned int i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 dv = _mm_loadu_ps(d + i);
+		__m128 mv = _mm_add_ps(_mm_mul_ps(b1, _mm_loadu_ps(m + i)), _mm_mul_ps(c1, dv));
+		__m128 vv = _mm_add_ps(_mm_mul_ps(b2, _mm_loadu_ps(v + i)), _mm_mul_ps(c2, _mm_mul_ps(dv, dv)));
+
+		_mm_storeu_ps(m + i, mv);
+		_mm_storeu_ps(v + i, vv);
+		_mm_storeu_ps(w + i, _mm_add_ps(_mm_loadu_ps(w + i), _mm_div_ps(_mm_mul_ps(lr, mv), _mm_add_ps(_mm_sqrt_ps(vv), eps))));
+	}
+
+	AdamStep_Scalar(w + i, m + i, v + i, d + i, count - i, learningRate, beta1, beta2, epsilon);
+}
+
+// ---------- AVX2 + FMA kernels ----------
+
+TARGET_AVX2 static inline float HorizontalSum_AVX2(__m256 v)
+{
+	__m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+	lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1));
+	return _mm_cvtss_f32(lo);
+}
+
+TARGET_AVX2 static float Dot_AVX2(const float* a, const float* b, unsigned int count)
+{
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 32 <= count; i += 32)
+	{
+		sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+		sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+		sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), sum2);
+		sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), sum3);
+	}
+
+	for (; i + 8 <= count; i += 8)
+		sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+
+	float sum = HorizontalSum_AVX2(_mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3)));
+
+	for (; i < count; i++)
+		sum += a[i] * b[i];
+
+	return sum;
+}
+
+TARGET_AVX2 static float SquaredDistance_AVX2(const float* a, const float* b, unsigned int count)
+{
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+		__m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+		sum0 = _mm256_fmadd_ps(d0, d0, sum0);
+		sum1 = _mm256_fmadd_ps(d1, d1, sum1);
+	}
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+		sum0 = _mm256_fmadd_ps(d, d, sum0);
+	}
+
+	float sum = HorizontalSum_AVX2(_mm256_add_ps(sum0, sum1));
+
+	for (; i < count; i++)
+		sum += (a[i] - b[i]) * (a[i] - b[i]);
+
+	return sum;
+}
+
+TARGET_AVX2 static void Dot4_AVX2(const float* rows, unsigned int stride, const float* x, unsigned int count, float* out)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+	__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 xv = _mm256_loadu_ps(x + i);
+		sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(r0 + i), xv, sum0);
+		sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(r1 + i), xv, sum1);
+		sum2 = _mm256_fmadd_ps(_mm256_loadu_ps(r2 + i), xv, sum2);
+		sum3 = _mm256_fmadd_ps(_mm256_loadu_ps(r3 + i), xv, sum3);
+	}
+
+	out[0] = HorizontalSum_AVX2(sum0);
+	out[1] = HorizontalSum_AVX2(sum1);
+	out[2] = HorizontalSum_AVX2(sum2);
+	out[3] = HorizontalSum_AVX2(sum3);
+
+	for (; i < count; i++)
+	{
+		out[0] += r0[i] * x[i];
+		out[1] += r1[i] * x[i];
+		out[2] += r2[i] * x[i];
+		out[3] += r3[i] * x[i];
+	}
+}
+
+TARGET_AVX2 static void Axpy_AVX2(float alpha, const float* x, float* y, unsigned int count)
+{
+	__m256 a = _mm256_set1_ps(alpha);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+		_mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+	}
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+
+	for (; i < count; i++)
+		y[i] += alpha * x[i];
+}
+
+TARGET_AVX2 static void Axpy4_AVX2(const float* alpha, const float* rows, unsigned int stride, float* y, unsigned int count)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+	__m256 a0 = _mm256_set1_ps(alpha[0]), a1 = _mm256_set1_ps(alpha[1]), a2 = _mm256_set1_ps(alpha[2]), a3 = _mm256_set1_ps(alpha[3]);
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 sum01 = _mm256_fmadd_ps(a1, _mm256_loadu_ps(r1 + i), _mm256_fmadd_ps(a0, _mm256_loadu_ps(r0 + i), _mm256_loadu_ps(y + i)));
+		__m256 sum23 = _mm256_fmadd_ps(a3, _mm256_loadu_ps(r3 + i), _mm256_mul_ps(a2, _mm256_loadu_ps(r2 + i)));
+		_mm256_storeu_ps(y + i, _mm256_add_ps(sum01, sum23));
+	}
+
+	for (; i < count; i++)
+		y[i] += (alpha[0] * r0[i] + alpha[1] * r1[i]) + (alpha[2] * r2[i] + alpha[3] * r3[i]);
+}
+
+TARGET_AVX2 static void Scale_AVX2(float alpha, float* x, unsigned int count)
+{
+	__m256 a = _mm256_set1_ps(alpha);
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(x + i, _mm256_mul_ps(a, _mm256_loadu_ps(x + i)));
+
+	for (; i < count; i++)
+		x[i] *= alpha;
+}
+
+TARGET_AVX2 static void Sigmoid_AVX2(float* x, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(x + i, Sigmoid8_AVX2(_mm256_loadu_ps(x + i)));
+
+	Sigmoid_Scalar(x + i, count - i);
+}
+
+TARGET_AVX2 static void QuantizeU7_AVX2(const float* x, float scale, float shift, unsigned char* q, unsigned int count)
+{
+	const __m256 s = _mm256_set1_ps(scale), b = _mm256_set1_ps(shift);
+	const __m256 low = _mm256_setzero_ps(), high = _mm256_set1_ps(127.0f);
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_fmadd_ps(_mm256_loadu_ps(x + i), s, b), low), high);
+		__m256i n = _mm256_cvtps_epi32(v);
+		__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(n), _mm256_extracti128_si256(n, 1));
+		_mm_storel_epi64((__m128i*)(q + i), _mm_packus_epi16(words, words));
+	}
+
+	QuantizeU7_Scalar(x + i, scale, shift, q + i, count - i);
+}
+
+TARGET_AVX2 static void Dequantize_AVX2(const int* x, const float* scale, const float* shift, float* y, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 v = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(x + i)));
+		_mm256_storeu_ps(y + i, _mm256_fmadd_ps(v, _mm256_loadu_ps(scale + i), _mm256_loadu_ps(shift + i)));
+	}
+
+	Dequantize_Scalar(x + i, scale + i, shift + i, y + i, count - i);
+}
+
+TARGET_AVX2 static void FP16ToFloat_AVX2(const unsigned short* x, float* y, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(y + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(x + i))));
+
+	FP16ToFloat_Scalar(x + i, y + i, count - i);
+}
+
+TARGET_AVX2 static void FloatToFP16_AVX2(const float* x, unsigned short* y, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm_storeu_si128((__m128i*)(y + i), _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT));
+
+	FloatToFP16_Scalar(x + i, y + i, count - i);
+}
+
+TARGET_AVX2 static void BF16ToFloat_AVX2(const unsigned short* x, float* y, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(x + i))), 16);
+		_mm256_storeu_ps(y + i, _mm256_castsi256_ps(bits));
+	}
+
+	BF16ToFloat_Scalar(x + i, y + i, count - i);
+}
+
+TARGET_AVX2 static void MomentumStep_AVX2(float* w, float* m, const float* d, unsigned int count, float learningRate, float momentum, bool nesterov)
+{
+	__m256 lr = _mm256_set1_ps(learningRate), mu = _mm256_set1_ps(momentum);
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 dv = _mm256_loadu_ps(d + i);
+		__m256 mv = _mm256_fmadd_ps(mu, _mm256_loadu_ps(m + i), dv);
+		__m256 step = nesterov ? _mm256_fmadd_ps(mu, mv, dv) : mv;
+
+		_mm256_storeu_ps(m + i, mv);
+		_mm256_storeu_ps(w + i, _mm256_fmadd_ps(lr, step, _mm256_loadu_ps(w + i)));
+	}
+
+	MomentumStep_Scalar(w + i, m + i, d + i, count - i, learningRate, momentum, nesterov);
+}
+
+TARGET_AVX2 static void AdamStep_AVX2(float* w, float* m, float* v, const float* d, unsigned int count, float learningRate, float beta1, float beta2, float epsilon)
+{
+	__m256 lr = _mm256_set1_ps(learningRate), eps = _mm256_set1_ps(epsilon);
+	__m256 b1 = _mm256_set1_ps(beta1), b2 = _mm256_set1_ps(beta2), c1 = _mm256_set1_ps(1.0f - beta1), c2 = _mm256_set1_ps(1.0f - beta2);
+	unsigned int i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 dv = _mm256_loadu_ps(d + i);
+		__m256 mv = _mm256_fmadd_ps(b1, _mm256_loadu_ps(m + i), _mm256_mul_ps(c1, dv));
+		__m256 vv = _mm256_fmadd_ps(b2, _mm256_loadu_ps(v + i), _mm256_mul_ps(c2, _mm256_mul_ps(dv, dv)));
+
+		_mm256_storeu_ps(m + i, mv);
+		_mm256_storeu_ps(v + i, vv);
+		_mm256_storeu_ps(w + i, _mm256_add_ps(_mm256_loadu_ps(w + i), _mm256_div_ps(_mm256_mul_ps(lr, mv), _mm256_add_ps(_mm256_sqrt_ps(vv), eps))));
+	}
+
+	AdamStep_Scalar(w + i, m + i, v + i, d + i, count - i, learningRate, beta1, beta2, epsilon);
+}
+
+// ---------- AVX-512 kernels ----------
+
+TARGET_AVX512 static inline __mmask16 TailMask_AVX512(unsigned int remain)
+{
+	return (__mmask16)((1u << remain) - 1);
+}
+
+TARGET_AVX512 static float Dot_AVX512(const float* a, const float* b, unsigned int count)
+{
+	__m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 64 <= count; i += 64)
+	{
+		sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+		sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), sum1);
+		sum2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), sum2);
+		sum3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), sum3);
+	}
+
+	for (; i + 16 <= count; i += 16)
+		sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), sum0);
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), sum1);
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(sum0, sum1), _mm512_add_ps(sum2, sum3)));
+}
+
+TARGET_AVX512 static float SquaredDistance_AVX512(const float* a, const float* b, unsigned int count)
+{
+	__m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 32 <= count; i += 32)
+	{
+		__m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+		__m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+		sum0 = _mm512_fmadd_ps(d0, d0, sum0);
+		sum1 = _mm512_fmadd_ps(d1, d1, sum1);
+	}
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+		sum0 = _mm512_fmadd_ps(d, d, sum0);
+	}
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		__m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+		sum1 = _mm512_fmadd_ps(d, d, sum1);
+	}
+
+	return _mm512_reduce_add_ps(_mm512_add_ps(sum0, sum1));
+}
+
+TARGET_AVX512 static void Dot4_AVX512(const float* rows, unsigned int stride, const float* x, unsigned int count, float* out)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+	__m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512 xv = _mm512_loadu_ps(x + i);
+		sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(r0 + i), xv, sum0);
+		sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(r1 + i), xv, sum1);
+		sum2 = _mm512_fmadd_ps(_mm512_loadu_ps(r2 + i), xv, sum2);
+		sum3 = _mm512_fmadd_ps(_mm512_loadu_ps(r3 + i), xv, sum3);
+	}
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		__m512 xv = _mm512_maskz_loadu_ps(mask, x + i);
+		sum0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, r0 + i), xv, sum0);
+		sum1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, r1 + i), xv, sum1);
+		sum2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, r2 + i), xv, sum2);
+		sum3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, r3 + i), xv, sum3);
+	}
+
+	out[0] = _mm512_reduce_add_ps(sum0);
+	out[1] = _mm512_reduce_add_ps(sum1);
+	out[2] = _mm512_reduce_add_ps(sum2);
+	out[3] = _mm512_reduce_add_ps(sum3);
+}
+
+TARGET_AVX512 static void Axpy_AVX512(float alpha, const float* x, float* y, unsigned int count)
+{
+	__m512 a = _mm512_set1_ps(alpha);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		_mm512_storeu_ps(y + i, _mm512_fmadd_ps(a, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		_mm512_mask_storeu_ps(y + i, mask, _mm512_fmadd_ps(a, _mm512_maskz_loadu_ps(mask, x + i), _mm512_maskz_loadu_ps(mask, y + i)));
+	}
+}
+
+TARGET_AVX512 static void Axpy4_AVX512(const float* alpha, const float* rows, unsigned int stride, float* y, unsigned int count)
+{
+	const float* r0 = rows, * r1 = rows + stride, * r2 = rows + 2 * (size_t)stride, * r3 = rows + 3 * (size_t)stride;
+	__m512 a0 = _mm512_set1_ps(alpha[0]), a1 = _mm512_set1_ps(alpha[1]), a2 = _mm512_set1_ps(alpha[2]), a3 = _mm512_set1_ps(alpha[3]);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512 sum01 = _mm512_fmadd_ps(a1, _mm512_loadu_ps(r1 + i), _mm512_fmadd_ps(a0, _mm512_loadu_ps(r0 + i), _mm512_loadu_ps(y + i)));
+		__m512 sum23 = _mm512_fmadd_ps(a3, _mm512_loadu_ps(r3 + i), _mm512_mul_ps(a2, _mm512_loadu_ps(r2 + i)));
+		_mm512_storeu_ps(y + i, _mm512_add_ps(sum01, sum23));
+	}
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		__m512 sum01 = _mm512_fmadd_ps(a1, _mm512_maskz_loadu_ps(mask, r1 + i), _mm512_fmadd_ps(a0, _mm512_maskz_loadu_ps(mask, r0 + i), _mm512_maskz_loadu_ps(mask, y + i)));
+		__m512 sum23 = _mm512_fmadd_ps(a3, _mm512_maskz_loadu_ps(mask, r3 + i), _mm512_mul_ps(a2, _mm512_maskz_loadu_ps(mask, r2 + i)));
+		_mm512_mask_storeu_ps(y + i, mask, _mm512_add_ps(sum01, sum23));
+	}
+}
+
+TARGET_AVX512 static void Scale_AVX512(float alpha, float* x, unsigned int count)
+{
+	__m512 a = _mm512_set1_ps(alpha);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		_mm512_storeu_ps(x + i, _mm512_mul_ps(a, _mm512_loadu_ps(x + i)));
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		_mm512_mask_storeu_ps(x + i, mask, _mm512_mul_ps(a, _mm512_maskz_loadu_ps(mask, x + i)));
+	}
+}
+
+TARGET_AVX512 static void Sigmoid_AVX512(float* x, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		_mm512_storeu_ps(x + i, Sigmoid16_AVX512(_mm512_loadu_ps(x + i)));
+
+	if (i < count)
+	{
+		__mmask16 mask = TailMask_AVX512(count - i);
+		_mm512_mask_storeu_ps(x + i, mask, Sigmoid16_AVX512(_mm512_maskz_loadu_ps(mask, x + i)));
+	}
+}
+
+TARGET_AVX512 static void QuantizeU7_AVX512(const float* x, float scale, float shift, unsigned char* q, unsigned int count)
+{
+	const __m512 s = _mm512_set1_ps(scale), b = _mm512_set1_ps(shift);
+	const __m512 low = _mm512_setzero_ps(), high = _mm512_set1_ps(127.0f);
+
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		__mmask16 mask = count - i >= 16 ? (__mmask16)0xFFFF : TailMask_AVX512(count - i);
+		__m512 v = _mm512_min_ps(_mm512_max_ps(_mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, x + i), s, b), low), high);
+		_mm512_mask_cvtepi32_storeu_epi8(q + i, mask, _mm512_cvtps_epi32(v));
+	}
+}
+
+TARGET_AVX512 static void Dequantize_AVX512(const int* x, const float* scale, const float* shift, float* y, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i += 16)
+	{
+		__mmask16 mask = count - i >= 16 ? (__mmask16)0xFFFF : TailMask_AVX512(count - i);
+		__m512 v = _mm512_cvtepi32_ps(_mm512_maskz_loadu_epi32(mask, x + i));
+		_mm512_mask_storeu_ps(y + i, mask, _mm512_fmadd_ps(v, _mm512_maskz_loadu_ps(mask, scale + i), _mm512_maskz_loadu_ps(mask, shift + i)));
+	}
+}
+
+TARGET_AVX512 static void FP16ToFloat_AVX512(const unsigned short* x, float* y, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		_mm512_storeu_ps(y + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(x + i))));
+
+	FP16ToFloat_AVX2(x + i, y + i, count - i);
+}
+
+TARGET_AVX512 static void BF16ToFloat_AVX512(const unsigned short* x, float* y, unsigned int count)
+{
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512i bits = _mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(x + i))), 16);
+		_mm512_storeu_ps(y + i, _mm512_castsi512_ps(bits));
+	}
+
+	BF16ToFloat_AVX2(x + i, y + i, count - i);
+}
+
+// Same rounding as the scalar kernel on 16 lanes, nan lanes are quieted instead of rounded
+TARGET_AVX512 static void FloatToBF16_AVX512(const float* x, unsigned short* y, unsigned int count)
+{
+	const __m512i one = _mm512_set1_epi32(1), half = _mm512_set1_epi32(0x7FFF), quiet = _mm512_set1_epi32(0x400000);
+	const __m512i magnitude = _mm512_set1_epi32(0x7FFFFFFF), infinity = _mm512_set1_epi32(0x7F800000);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+	{
+		__m512i bits = _mm512_castps_si512(_mm512_loadu_ps(x + i));
+		__m512i rounded = _mm512_add_epi32(bits, _mm512_add_epi32(half, _mm512_and_si512(_mm512_srli_epi32(bits, 16), one)));
+		__mmask16 nan = _mm512_cmpgt_epi32_mask(_mm512_and_si512(bits, magnitude), infinity);
+
+		rounded = _mm512_mask_or_epi32(rounded, nan, bits, quiet);
+		_mm256_storeu_si256((__m256i*)(y + i), _mm512_cvtepi32_epi16(_mm512_srli_epi32(rounded, 16)));
+	}
+
+	FloatToBF16_Scalar(x + i, y + i, count - i);
+}
+
+TARGET_AVX512 static inline void MomentumStep_AVX512(float* w, float* m, const float* d, __mmask16 mask, __m512 lr, __m512 mu, bool nesterov)
+{
+	__m512 dv = _mm512_maskz_loadu_ps(mask, d);
+	__m512 mv = _mm512_fmadd_ps(mu, _mm512_maskz_loadu_ps(mask, m), dv);
+	__m512 step = nesterov ? _mm512_fmadd_ps(mu, mv, dv) : mv;
+
+	_mm512_mask_storeu_ps(m, mask, mv);
+	_mm512_mask_storeu_ps(w, mask, _mm512_fmadd_ps(lr, step, _mm512_maskz_loadu_ps(mask, w)));
+}
+
+TARGET_AVX512 static void MomentumStep_AVX512(float* w, float* m, const float* d, unsigned int count, float learningRate, float momentum, bool nesterov)
+{
+	__m512 lr = _mm512_set1_ps(learningRate), mu = _mm512_set1_ps(momentum);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		MomentumStep_AVX512(w + i, m + i, d + i, 0xFFFF, lr, mu, nesterov);
+
+	if (i < count)
+		MomentumStep_AVX512(w + i, m + i, d + i, TailMask_AVX512(count - i), lr, mu, nesterov);
+}
+
+TARGET_AVX512 static inline void AdamStep_AVX512(float* w, float* m, float* v, const float* d, __mmask16 mask, __m512 lr, __m512 b1, __m512 b2, __m512 eps)
+{
+	__m512 one = _mm512_set1_ps(1.0f);
+
+	__m512 dv = _mm512_maskz_loadu_ps(mask, d);
+	__m512 mv = _mm512_fmadd_ps(b1, _mm512_maskz_loadu_ps(mask, m), _mm512_mul_ps(_mm512_sub_ps(one, b1), dv));
+	__m512 vv = _mm512_fmadd_ps(b2, _mm512_maskz_loadu_ps(mask, v), _mm512_mul_ps(_mm512_sub_ps(one, b2), _mm512_mul_ps(dv, dv)));
+
+	_mm512_mask_storeu_ps(m, mask, mv);
+	_mm512_mask_storeu_ps(v, mask, vv);
+	_mm512_mask_storeu_ps(w, mask, _mm512_add_ps(_mm512_maskz_loadu_ps(mask, w), _mm512_div_ps(_mm512_mul_ps(lr, mv), _mm512_add_ps(_mm512_sqrt_ps(vv), eps))));
+}
+
+TARGET_AVX512 static void AdamStep_AVX512(float* w, float* m, float* v, const float* d, unsigned int count, float learningRate, float beta1, float beta2, float epsilon)
+{
+	__m512 lr = _mm512_set1_ps(learningRate), eps = _mm512_set1_ps(epsilon);
+	__m512 b1 = _mm512_set1_ps(beta1), b2 = _mm512_set1_ps(beta2);
+	unsigned int i = 0;
+
+	for (; i + 16 <= count; i += 16)
+		AdamStep_AVX512(w + i, m + i, v + i, d + i, 0xFFFF, lr, b1, b2, eps);
+
+	if (i < count)
+		AdamStep_AVX512(w + i, m + i, v + i, d + i, TailMask_AVX512(count - i), lr, b1, b2, eps);
+}
+
+// ---------- CPU feature detection ----------
+
+static void CpuId(int leaf, int subLeaf, int* info)
+{
+#ifdef _MSC_VER
+	__cpuidex(info, leaf, subLeaf);
+#else
+	__cpuid_count(leaf, subLeaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+// Register state the OS saves on context switch (XCR0)
+static unsigned long long XGetBV()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+#endif
+
+// AVX512-BW and AVX512-VNNI on top of the AVX-512 level
+static bool DetectVNNI()
+{
+#ifdef VA_X86
+	int info[4];
+
+	CpuId(0, 0, info);
+	if (info[0] < 7) return false;
+
+	CpuId(7, 0, info);
+	bool avx512bw = info[1] & (1 << 30);
+	bool avx512vnni = info[2] & (1 << 11);
+
+	return avx512bw && avx512vnni;
+#else
+	return false;
+#endif
+}
+
+// AVX512-BF16 on top of the AVX-512 level, reported in sub-leaf 1 of leaf 7
+static bool DetectBF16()
+{
+#ifdef VA_X86
+	int info[4];
+
+	CpuId(0, 0, info);
+	if (info[0] < 7) return false;
+
+	CpuId(7, 0, info);
+	if (info[0] < 1) return false;
+
+	CpuId(7, 1, info);
+	return info[0] & (1 << 5);
+#else
+	return false;
+#endif
+}
+
+static SIMDLevel DetectLevel()
+{
+#ifdef VA_X86
+	int info[4];
+
+	CpuId(0, 0, info);
+	int maxLeaf = info[0];
+
+	CpuId(1, 0, info);
+	bool sse2 = info[3] & (1 << 26);
+	bool fma = info[2] & (1 << 12);
+	bool osxsave = info[2] & (1 << 27);
+	bool avx = info[2] & (1 << 28);
+	bool f16c = info[2] & (1 << 29);
+
+	if (!sse2) return SIMDLevel::Scalar;
+	if (!osxsave || !avx || maxLeaf < 7) return SIMDLevel::SSE;
+
+	// OS must save XMM/YMM state for AVX, and opmask/ZMM state for AVX-512
+	unsigned long long xcr0 = XGetBV();
+	if ((xcr0 & 0x6) != 0x6) return SIMDLevel::SSE;
+
+	CpuId(7, 0, info);
+	bool avx2 = info[1] & (1 << 5);
+	bool avx512f = info[1] & (1 << 16);
+
+	// F16C ships with every AVX2 CPU, the levels above SSE rely on it for half-precision weights
+	if (avx512f && fma && f16c && (xcr0 & 0xE6) == 0xE6) return SIMDLevel::AVX512;
+	if (avx2 && fma && f16c) return SIMDLevel::AVX2;
+
+	return SIMDLevel::SSE;
+#else
+	return SIMDLevel::Scalar;
+#endif
+}
+
+static KernelTable GetKernelTable(SIMDLevel level)
+{
+	switch (level)
+	{
+#ifdef VA_X86
+	case SIMDLevel::AVX512:
+		return { SIMDLevel::AVX512, &Dot_AVX512, &Dot4_AVX512, &Axpy_AVX512, &Axpy4_AVX512, &Scale_AVX512, &Sigmoid_AVX512, &QuantizeU7_AVX512, &Dequantize_AVX512, &FP16ToFloat_AVX512, &BF16ToFloat_AVX512, &FloatToFP16_AVX2, &FloatToBF16_AVX512,
+			&MomentumStep_AVX512, &AdamStep_AVX512, &SquaredDistance_AVX512 };
+	case SIMDLevel::AVX2:
+		return { SIMDLevel::AVX2, &Dot_AVX2, &Dot4_AVX2, &Axpy_AVX2, &Axpy4_AVX2, &Scale_AVX2, &Sigmoid_AVX2, &QuantizeU7_AVX2, &Dequantize_AVX2, &FP16ToFloat_AVX2, &BF16ToFloat_AVX2, &FloatToFP16_AVX2, &FloatToBF16_Scalar,
+			&MomentumStep_AVX2, &AdamStep_AVX2, &SquaredDistance_AVX2 };
+	case SIMDLevel::SSE:
+		return { SIMDLevel::SSE, &Dot_SSE, &Dot4_SSE, &Axpy_SSE, &Axpy4_SSE, &Scale_SSE, &Sigmoid_Scalar, &QuantizeU7_Scalar, &Dequantize_Scalar, &FP16ToFloat_Scalar, &BF16ToFloat_Scalar, &FloatToFP16_Scalar, &FloatToBF16_Scalar,
+			&MomentumStep_SSE, &AdamStep_SSE, &SquaredDistance_SSE };
+#endif
+	default:
+		return { SIMDLevel::Scalar, &Dot_Scalar, &Dot4_Scalar, &Axpy_Scalar, &Axpy4_Scalar, &Scale_Scalar, &Sigmoid_Scalar, &QuantizeU7_Scalar, &Dequantize_Scalar, &FP16ToFloat_Scalar, &BF16ToFloat_Scalar, &FloatToFP16_Scalar, &FloatToBF16_Scalar,
+			&MomentumStep_Scalar, &AdamStep_Scalar, &SquaredDistance_Scalar };
+	}
+}
+
+// Constant-initialized to the scalar kernels, so calls made during static initialization are safe
+static KernelTable kernels = { SIMDLevel::Scalar, &Dot_Scalar, &Dot4_Scalar, &Axpy_Scalar, &Axpy4_Scalar, &Scale_Scalar, &Sigmoid_Scalar, &QuantizeU7_Scalar, &Dequantize_Scalar,
+	&FP16ToFloat_Scalar, &BF16ToFloat_Scalar, &FloatToFP16_Scalar, &FloatToBF16_Scalar, &MomentumStep_Scalar, &AdamStep_Scalar, &SquaredDistance_Scalar };
+static const SIMDLevel supportedLevel = DetectLevel();
+static const bool vnniSupported = DetectVNNI();
+static const bool bf16Supported = DetectBF16();
+static const SIMDLevel initialLevel = VectorAccelator::SetLevel(SIMDLevel::AVX512);
+
+float VectorAccelator::Dot(const float* a, const float* b, unsigned int count)
+{
+	return kernels.dot(a, b, count);
+}
+
+void VectorAccelator::Dot4(const float* rows, unsigned int stride, const float* x, unsigned int count, float* out)
+{
+	kernels.dot4(rows, stride, x, count, out);
+}
+
+void VectorAccelator::Axpy(float alpha, const float* x, float* y, unsigned int count)
+{
+	kernels.axpy(alpha, x, y, count);
+}
+
+void VectorAccelator::Axpy4(const float* alpha, const float* rows, unsigned int stride, float* y, unsigned int count)
+{
+	kernels.axpy4(alpha, rows, stride, y, count);
+}
+
+void VectorAccelator::Scale(float alpha, float* x, unsigned int count)
+{
+	kernels.scale(alpha, x, count);
+}
+
+void VectorAccelator::Sigmoid(float* x, unsigned int count)
+{
+	kernels.sigmoid(x, count);
+}
+
+void VectorAccelator::QuantizeU7(const float* x, float scale, float shift, unsigned char* q, unsigned int count)
+{
+	kernels.quantizeU7(x, scale, shift, q, count);
+}
+
+void VectorAccelator::Dequantize(const int* x, const float* scale, const float* shift, float* y, unsigned int count)
+{
+	kernels.dequantize(x, scale, shift, y, count);
+}
+
+float VectorAccelator::SquaredDistance(const float* a, const float* b, unsigned int count)
+{
+	return kernels.squaredDistance(a, b, count);
+}
+
+void VectorAccelator::MomentumStep(float* w, float* m, const float* d, unsigned int count, float learningRate, float momentum, bool nesterov)
+{
+	kernels.momentumStep(w, m, d, count, learningRate, momentum, nesterov);
+}
+
+void VectorAccelator::AdamStep(float* w, float* m, float* v, const float* d, unsigned int count, float learningRate, float beta1, float beta2, float epsilon)
+{
+	kernels.adamStep(w, m, v, d, count, learningRate, beta1, beta2, epsilon);
+}
+
+void VectorAccelator::HalfToFloat(const unsigned short* x, float* y, unsigned int count, HalfFormat format)
+{
+	if (format == HalfFormat::BF16)
+		kernels.bf16ToFloat(x, y, count);
+	else
+		kernels.fp16ToFloat(x, y, count);
+}
+
+void VectorAccelator::FloatToHalf(const float* x, unsigned short* y, unsigned int count, HalfFormat format)
+{
+	if (format == HalfFormat::BF16)
+		kernels.floatToBF16(x, y, count);
+	else
+		kernels.floatToFP16(x, y, count);
+}
+
+SIMDLevel VectorAccelator::GetLevel()
+{
+	return kernels.level;
+}
+
+SIMDLevel VectorAccelator::GetSupportedLevel()
+{
+	return supportedLevel;
+}
+
+SIMDLevel VectorAccelator::SetLevel(SIMDLevel level)
+{
+	if ((int)level > (int)supportedLevel)
+		level = supportedLevel;
+
+	kernels = GetKernelTable(level);
+	return level;
+}
+
+bool VectorAccelator::HasVNNI()
+{
+	return vnniSupported && supportedLevel == SIMDLevel::AVX512;
+}
+
+bool VectorAccelator::HasBF16()
+{
+	return bf16Supported && supportedLevel == SIMDLevel::AVX512;
+}
+
+const char* VectorAccelator::GetLevelName(SIMDLevel level)
+{
+	switch (level)
+	{
+	case SIMDLevel::SSE:
+		return "SSE";
+	case SIMDLevel::AVX2:
+		return "AVX2";
+	case SIMDLevel::AVX512:
+		return "AVX-512";
+	default:
+		return "Scalar";
+	}
+}
@@ -1,6 +1,20 @@
 #pragma once
 
+// Instruction sets the accelerator can dispatch to, in ascending order
+enum class SIMDLevel : int
+{
+	Scalar, SSE, AVX2, AVX512
+};
+
+// 16-bit float formats weights can be stored in
+enum class HalfFormat : int
+{
+	FP16, // IEEE binary16
+	BF16 // upper half of a binary32
+};
+
 // Accelerate vector computations by utilizing SIMD instructions
+// Kernels are selected once at startup according to CPUID, scalar code is used as fallback
 class VectorAccelator
 {
 public:
@@ -9,4 +23,94 @@ public:
 	/// </summary>
 	/// <returns>Dot product</returns>
 	static float Dot(const float* a, const float* b, unsigned int count);
+
+	/// <summary>
+	/// Dot Product of 4 rows against the same vector, rows are stride elements apart
+	/// </summary>
+	/// <param name="out">Receives 4 dot products</param>
+	static void Dot4(const float* rows, unsigned int stride, const float* x, unsigned int count, float* out);
+
+	/// <summary>
+	/// y += alpha * x
+	/// </summary>
+	static void Axpy(float alpha, const float* x, float* y, unsigned int count);
+
+	/// <summary>
+	/// y += alpha[0] * row0 + ... + alpha[3] * row3, rows are stride elements apart
+	/// </summary>
+	static void Axpy4(const float* alpha, const float* rows, unsigned int stride, float* y, unsigned int count);
+
+	/// <summary>
+	/// x *= alpha
+	/// </summary>
+	static void Scale(float alpha, float* x, unsigned int count);
+
+	/// <summary>
+	/// x = 1 / (1 + exp(-x)), using a polynomial exp approximation on AVX2 and up
+	/// </summary>
+	static void Sigmoid(float* x, unsigned int count);
+
+	/// <summary>
+	/// q = round(x * scale + shift), clamped to [0, 127]
+	/// </summary>
+	static void QuantizeU7(const float* x, float scale, float shift, unsigned char* q, unsigned int count);
+
+	/// <summary>
+	/// y = x * scale + shift, scale and shift per element
+	/// </summary>
+	static void Dequantize(const int* x, const float* scale, const float* shift, float* y, unsigned int count);
+
+	/// <summary>
+	/// Squared Euclidean distance, sum of (a - b)^2
+	/// </summary>
+	static float SquaredDistance(const float* a, const float* b, unsigned int count);
+
+	/// <summary>
+	/// m = momentum * m + d, then w += learningRate * m, or w += learningRate * (momentum * m + d) for Nesterov
+	/// </summary>
+	static void MomentumStep(float* w, float* m, const float* d, unsigned int count, float learningRate, float momentum, bool nesterov);
+
+	/// <summary>
+	/// m = beta1 * m + (1 - beta1) * d, v = beta2 * v + (1 - beta2) * d^2, then w += learningRate * m / (sqrt(v) + epsilon)
+	/// Bias correction is left to the caller, folded into learningRate and epsilon
+	/// </summary>
+	static void AdamStep(float* w, float* m, float* v, const float* d, unsigned int count, float learningRate, float beta1, float beta2, float epsilon);
+
+	/// <summary>
+	/// Widen 16-bit floats, F16C/AVX-512 for FP16, a shift for BF16
+	/// </summary>
+	static void HalfToFloat(const unsigned short* x, float* y, unsigned int count, HalfFormat format);
+
+	/// <summary>
+	/// Narrow floats to 16 bits, rounding to nearest even
+	/// </summary>
+	static void FloatToHalf(const float* x, unsigned short* y, unsigned int count, HalfFormat format);
+
+	/// <summary>
+	/// Instruction set currently in use
+	/// </summary>
+	static SIMDLevel GetLevel();
+
+	/// <summary>
+	/// Highest instruction set supported by the CPU and OS
+	/// </summary>
+	static SIMDLevel GetSupportedLevel();
+
+	/// <summary>
+	/// Select kernels of a given instruction set, clamped to what the CPU supports
+	/// </summary>
+	/// <returns>Instruction set actually selected</returns>
+	static SIMDLevel SetLevel(SIMDLevel level);
+
+	/// <summary>
+	/// Whether the CPU supports AVX512-BW and AVX512-VNNI, for the integer kernels of the AVX-512 level
+	/// </summary>
+	static bool HasVNNI();
+
+	/// <summary>
+	/// Whether the CPU supports AVX512-BF16, for the BF16 products of MatrixAccelator
+	/// </summary>
+	static bool HasBF16();
+
+	static const char* GetLevelName(SIMDLevel level);
 };
@@ -0,0 +1,172 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+using namespace Network;
+
+WorkerPool::WorkerPool(int threadCount)
+{
+	if (threadCount <= 0)
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+	workerCount = threadCount;
+	shares.reset(new Share[workerCount]);
+
+	currentGrain = 1;
+	generation = 0;
+	pending = 0;
+	quit = false;
+
+	// worker 0 is the thread calling Run()
+	for (int i = 1; i < workerCount; i++)
+		threads.push_back(std::thread(&WorkerPool::WorkerMain, this, i));
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		quit = true;
+	}
+	startSignal.notify_all();
+
+	for (auto& thread : threads)
+		thread.join();
+}
+
+int WorkerPool::Count()
+{
+	return workerCount;
+}
+
+void WorkerPool::Run(int count, int grain, RangeTask task)
+{
+	if (count <= 0)
+		return;
+
+	currentTask = task;
+	currentGrain = std::max(1, grain);
+	error = nullptr;
+
+	// even contiguous shares, workers are asleep until the generation changes
+	for (int i = 0; i < workerCount; i++)
+	{
+		shares[i].begin = (int)((long long)count * i / workerCount);
+		shares[i].end = (int)((long long)count * (i + 1) / workerCount);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending = workerCount;
+		generation++;
+	}
+	startSignal.notify_all();
+
+	Work(0);
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		pending--;
+		doneSignal.wait(guard, [this] { return pending == 0; });
+	}
+
+	currentTask = nullptr;
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void WorkerPool::WorkerMain(int worker)
+{
+	long long seen = 0;
+
+	while (1)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			startSignal.wait(guard, [&] { return quit || generation != seen; });
+
+			if (quit)
+				return;
+
+			seen = generation;
+		}
+
+		Work(worker);
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (--pending == 0)
+				doneSignal.notify_one();
+		}
+	}
+}
+
+void WorkerPool::Work(int worker)
+{
+	int begin, end;
+
+	do
+	{
+		while (Take(worker, begin, end))
+		{
+			try
+			{
+				currentTask(worker, begin, end);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				if (!error)
+					error = std::current_exception();
+			}
+		}
+	} while (Steal(worker));
+}
+
+bool WorkerPool::Take(int worker, int& begin, int& end)
+{
+	Share& share = shares[worker];
+	std::lock_guard<std::mutex> guard(share.lock);
+
+	if (share.begin >= share.end)
+		return false;
+
+	begin = share.begin;
+	end = std::min(share.begin + currentGrain, share.end);
+	share.begin = end;
+
+	return true;
+}
+
+bool WorkerPool::Steal(int worker)
+{
+	// a share emptied once only refills when its owner steals, so a failed pass means the job is drained
+	for (int i = 1; i < workerCount; i++)
+	{
+		Share& victim = shares[(worker + i) % workerCount];
+		int begin, end;
+
+		{
+			std::lock_guard<std::mutex> guard(victim.lock);
+
+			int remaining = victim.end - victim.begin;
+			if (remaining <= 0)
+				continue;
+
+			// back half, the victim keeps working on the front
+			begin = victim.end - (remaining + 1) / 2;
+			end = victim.end;
+			victim.end = begin;
+		}
+
+		Share& own = shares[worker];
+		std::lock_guard<std::mutex> guard(own.lock);
+		own.begin = begin;
+		own.end = end;
+
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,73 @@
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+
+namespace Network
+{
+	// Persistent threads running index ranges with work stealing
+	// Every worker starts on an even share of the range and takes chunks from its front,
+	// idle workers steal the back half of another worker's share
+	// The calling thread takes part as worker 0, threads sleep between jobs
+	class WorkerPool
+	{
+	public:
+		/// <summary>
+		/// Receives the worker index and a chunk [begin, end) of the job
+		/// </summary>
+		typedef std::function<void(int worker, int begin, int end)> RangeTask;
+
+		/// <summary>
+		/// Start a pool, threadCount includes the calling thread, 0 for one per hardware thread
+		/// </summary>
+		WorkerPool(int threadCount = 0);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		int Count();
+
+		/// <summary>
+		/// Run task over [0, count) in chunks of at most grain indices, returns once every chunk is done
+		/// The first exception thrown by a chunk is rethrown here
+		/// </summary>
+		void Run(int count, int grain, RangeTask task);
+
+	private:
+		// one cache line per worker, so owners and thieves of different shares don't contend
+		struct alignas(64) Share
+		{
+			std::mutex lock;
+			int begin = 0, end = 0;
+		};
+
+		std::vector<std::thread> threads;
+		std::unique_ptr<Share[]> shares;
+		int workerCount;
+
+		RangeTask currentTask;
+		int currentGrain;
+
+		std::mutex lock;
+		std::condition_variable startSignal, doneSignal;
+		long long generation;
+		int pending; // workers still busy with the current job
+		bool quit;
+
+		std::exception_ptr error;
+
+		void WorkerMain(int worker);
+		void Work(int worker);
+		bool Take(int worker, int& begin, int& end);
+		bool Steal(int worker);
+	};
+}
+
+#endif